@@ -0,0 +1,21 @@
+rem Build Script for benchmarks
+@echo off
+setlocal enableDelayedExpansion
+
+rem Get a list of all .c files
+for /r %%f in (*.c) do (
+  set cFilenames=!cFilenames! %%f
+)
+
+set assembly=benchmarks
+
+rem Benchmarks are only meaningful with optimizations on.
+set compilerFlags=-g -O2 -Wall -Werror
+set includeFlags=-Isrc -I../engine/src
+
+set linkerFlags=-L../bin/ -lengine.lib
+
+set defines=-DKIMPORT
+
+echo "Building %assembly%%..."
+clang %cFilenames% %compilerFlags% -o ../bin/%assembly%.exe %defines% %includeFlags% %linkerFlags%
@@ -0,0 +1,104 @@
+#include "bench.h"
+
+#include <stdio.h>
+
+#if KPLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+// More than this many threads are never needed to show scaling.
+#define BENCH_MAX_THREADS 64
+
+typedef struct bench_thread {
+    PFN_bench_thread fn;
+    void* arg;
+    volatile b8* start;
+} bench_thread;
+
+f64 bench_time_now()
+{
+#if KPLATFORM_WINDOWS
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    return (f64)now.QuadPart / (f64)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)now.tv_sec + (f64)now.tv_nsec * 0.000000001;
+#endif
+}
+
+static void bench_thread_body(bench_thread* thread)
+{
+    while (!__atomic_load_n(thread->start, __ATOMIC_ACQUIRE)) {
+    }
+    thread->fn(thread->arg);
+}
+
+#if KPLATFORM_WINDOWS
+static DWORD WINAPI bench_thread_entry(LPVOID arg)
+{
+    bench_thread_body(arg);
+    return 0;
+}
+#else
+static void* bench_thread_entry(void* arg)
+{
+    bench_thread_body(arg);
+    return 0;
+}
+#endif
+
+f64 bench_run_threads(u32 thread_count, PFN_bench_thread fn, void* args, u64 arg_stride)
+{
+    if (thread_count > BENCH_MAX_THREADS)
+        thread_count = BENCH_MAX_THREADS;
+
+    volatile b8 start = FALSE;
+    bench_thread threads[BENCH_MAX_THREADS];
+#if KPLATFORM_WINDOWS
+    HANDLE handles[BENCH_MAX_THREADS];
+#else
+    pthread_t handles[BENCH_MAX_THREADS];
+#endif
+
+    for (u32 i = 0; i < thread_count; ++i) {
+        threads[i].fn = fn;
+        threads[i].arg = (u8*)args + i * arg_stride;
+        threads[i].start = &start;
+#if KPLATFORM_WINDOWS
+        handles[i] = CreateThread(0, 0, bench_thread_entry, &threads[i], 0, 0);
+#else
+        pthread_create(&handles[i], 0, bench_thread_entry, &threads[i]);
+#endif
+    }
+
+    f64 start_time = bench_time_now();
+    __atomic_store_n(&start, TRUE, __ATOMIC_RELEASE);
+
+#if KPLATFORM_WINDOWS
+    WaitForMultipleObjects(thread_count, handles, TRUE, INFINITE);
+    for (u32 i = 0; i < thread_count; ++i)
+        CloseHandle(handles[i]);
+#else
+    for (u32 i = 0; i < thread_count; ++i)
+        pthread_join(handles[i], 0);
+#endif
+
+    return bench_time_now() - start_time;
+}
+
+void bench_report(const char* name, u64 operations, f64 seconds)
+{
+    printf("  %-48s %10.2f Mops/s  (%.3fs)\n", name, (f64)operations / seconds / 1000000.0, seconds);
+}
+
+void bench_report_bandwidth(const char* name, u64 bytes, f64 seconds)
+{
+    printf("  %-48s %10.2f GiB/s  (%.3fs)\n", name, (f64)bytes / seconds / (1024.0 * 1024.0 * 1024.0), seconds);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <defines.h>
+
+// Returns a monotonic time in seconds.
+f64 bench_time_now();
+
+typedef void (*PFN_bench_thread)(void* arg);
+
+/**
+ * Runs thread_count threads at once and waits for all of them. Every thread is created before
+ * any of them starts, so thread creation is not part of the measured time.
+ * @param thread_count The number of threads to run.
+ * @param fn The function every thread runs.
+ * @param args An array of thread_count arguments, one per thread.
+ * @param arg_stride The size in bytes of a single argument.
+ * @returns The wall time in seconds from the threads starting to the last one finishing.
+ */
+f64 bench_run_threads(u32 thread_count, PFN_bench_thread fn, void* args, u64 arg_stride);
+
+// Keeps the compiler from optimizing away the computation of value.
+#define BENCH_KEEP(value) __asm__ volatile("" : : "g"(value) : "memory")
+
+// Prints a single result line, as millions of operations per second.
+void bench_report(const char* name, u64 operations, f64 seconds);
+
+// Prints a single result line, as gibibytes per second.
+void bench_report_bandwidth(const char* name, u64 bytes, f64 seconds);
+
+// Each benchmark suite prints its own results.
+void bench_kmemory_run();
+void bench_darray_run();
+void bench_ring_queue_run();
@@ -0,0 +1,175 @@
+#include "bench.h"
+
+#include <containers/darray.h>
+
+#include <stdio.h>
+
+#define ELEMENT_COUNT 1024
+#define PASSES 20000
+
+/**
+ * Iterates a darray the way event_fire and the device enumeration do, re-reading the length on every
+ * step. Before the header was exposed, every one of those reads was a call into the engine.
+ */
+static void iteration_cost()
+{
+    u32* array = darray_reserve(u32, ELEMENT_COUNT);
+    for (u32 i = 0; i < ELEMENT_COUNT; ++i)
+        darray_push(array, i);
+
+    printf("Iterating %u elements, length read every step:\n", ELEMENT_COUNT);
+
+    u64 sum = 0;
+    f64 start = bench_time_now();
+    for (u32 pass = 0; pass < PASSES; ++pass) {
+        for (u64 i = 0; i < _darray_field_get(array, DARRAY_LENGTH); ++i)
+            sum += array[i];
+        BENCH_KEEP(sum);
+    }
+    bench_report("exported _darray_field_get (old darray_length)", (u64)ELEMENT_COUNT * PASSES, bench_time_now() - start);
+
+    start = bench_time_now();
+    for (u32 pass = 0; pass < PASSES; ++pass) {
+        for (u64 i = 0; i < darray_length(array); ++i)
+            sum += array[i];
+        BENCH_KEEP(sum);
+    }
+    bench_report("inline darray_length", (u64)ELEMENT_COUNT * PASSES, bench_time_now() - start);
+
+    darray_destroy(array);
+}
+
+#define REMOVAL_COUNT 4096
+#define REMOVAL_PASSES 50
+
+/**
+ * Empties an array from the front one element at a time, the worst case for an ordered removal,
+ * and compares it with swap-remove and with erasing the whole run at once.
+ */
+static void removal_cost()
+{
+    static const char* labels[] = { "pop_at(0), ordered", "swap_remove(0), unordered", "erase_range, all at once" };
+
+    u64* array = darray_reserve(u64, REMOVAL_COUNT);
+    printf("Removing %u elements from the front:\n", REMOVAL_COUNT);
+
+    for (u32 method = 0; method < 3; ++method) {
+        f64 seconds = 0;
+        for (u32 pass = 0; pass < REMOVAL_PASSES; ++pass) {
+            darray_clear(array);
+            for (u64 i = 0; i < REMOVAL_COUNT; ++i)
+                darray_push(array, i);
+
+            f64 start = bench_time_now();
+            if (method == 0) {
+                while (darray_length(array))
+                    darray_pop_at(array, 0, 0);
+            } else if (method == 1) {
+                while (darray_length(array))
+                    darray_swap_remove(array, 0, 0);
+            } else {
+                darray_erase_range(array, 0, darray_length(array));
+            }
+            seconds += bench_time_now() - start;
+            BENCH_KEEP(array);
+        }
+        bench_report(labels[method], (u64)REMOVAL_COUNT * REMOVAL_PASSES, seconds);
+    }
+
+    darray_destroy(array);
+}
+
+typedef struct vec3 {
+    f32 x, y, z;
+} vec3;
+
+DARRAY_DEFINE(vec3)
+
+#define TYPED_COUNT 4096
+#define TYPED_PASSES 2000
+#define TYPED_INSERT_COUNT 512
+
+/**
+ * Compares the functions DARRAY_DEFINE generates with the generic macros on the same work: filling
+ * an array with pushes, summing it through get, and inserting at the front. The generic macros go
+ * through the stride and an exported copy for every element.
+ */
+static void typed_versus_generic()
+{
+    vec3* array = darray_reserve(vec3, TYPED_COUNT);
+    printf("Pushing and reading %u vec3 elements, typed versus generic:\n", TYPED_COUNT);
+
+    f64 start = bench_time_now();
+    for (u32 pass = 0; pass < TYPED_PASSES; ++pass) {
+        darray_clear(array);
+        for (u32 i = 0; i < TYPED_COUNT; ++i) {
+            vec3 v = { (f32)i, (f32)pass, 1.0f };
+            darray_push(array, v);
+        }
+        BENCH_KEEP(array);
+    }
+    bench_report("generic darray_push", (u64)TYPED_COUNT * TYPED_PASSES, bench_time_now() - start);
+
+    start = bench_time_now();
+    for (u32 pass = 0; pass < TYPED_PASSES; ++pass) {
+        darray_clear(array);
+        for (u32 i = 0; i < TYPED_COUNT; ++i) {
+            vec3 v = { (f32)i, (f32)pass, 1.0f };
+            array = darray_vec3_push(array, v);
+        }
+        BENCH_KEEP(array);
+    }
+    bench_report("typed darray_vec3_push", (u64)TYPED_COUNT * TYPED_PASSES, bench_time_now() - start);
+
+    f32 sum = 0;
+    start = bench_time_now();
+    for (u32 pass = 0; pass < TYPED_PASSES; ++pass) {
+        for (u64 i = 0; i < darray_length(array); ++i)
+            sum += array[i].x + array[i].y + array[i].z;
+        BENCH_KEEP(sum);
+    }
+    bench_report("generic indexing", (u64)TYPED_COUNT * TYPED_PASSES, bench_time_now() - start);
+
+    start = bench_time_now();
+    for (u32 pass = 0; pass < TYPED_PASSES; ++pass) {
+        for (u64 i = 0; i < darray_length(array); ++i) {
+            vec3 v = darray_vec3_get(array, i);
+            sum += v.x + v.y + v.z;
+        }
+        BENCH_KEEP(sum);
+    }
+    bench_report("typed darray_vec3_get", (u64)TYPED_COUNT * TYPED_PASSES, bench_time_now() - start);
+
+    printf("Inserting %u vec3 elements at the front, typed versus generic:\n", TYPED_INSERT_COUNT);
+    vec3 v = { 1.0f, 2.0f, 3.0f };
+    f64 seconds = 0;
+    for (u32 pass = 0; pass < TYPED_PASSES / 10; ++pass) {
+        darray_clear(array);
+        start = bench_time_now();
+        for (u32 i = 0; i < TYPED_INSERT_COUNT; ++i)
+            darray_insert_at(array, 0, v);
+        seconds += bench_time_now() - start;
+        BENCH_KEEP(array);
+    }
+    bench_report("generic darray_insert_at", (u64)TYPED_INSERT_COUNT * (TYPED_PASSES / 10), seconds);
+
+    seconds = 0;
+    for (u32 pass = 0; pass < TYPED_PASSES / 10; ++pass) {
+        darray_clear(array);
+        start = bench_time_now();
+        for (u32 i = 0; i < TYPED_INSERT_COUNT; ++i)
+            array = darray_vec3_insert(array, 0, v);
+        seconds += bench_time_now() - start;
+        BENCH_KEEP(array);
+    }
+    bench_report("typed darray_vec3_insert", (u64)TYPED_INSERT_COUNT * (TYPED_PASSES / 10), seconds);
+
+    darray_destroy(array);
+}
+
+void bench_darray_run()
+{
+    iteration_cost();
+    removal_cost();
+    typed_versus_generic();
+}
@@ -0,0 +1,118 @@
+#include "bench.h"
+
+#include <core/kmemory.h>
+
+#include <stdio.h>
+
+// Blocks each thread keeps alive at once, so allocations and frees interleave as they do in a frame.
+#define LIVE_BLOCKS 64
+#define ITERATIONS 1000000
+
+typedef struct allocation_worker {
+    u64 min_size;
+    u64 max_size;
+    u32 seed;
+} allocation_worker;
+
+static u32 random_next(u32* seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+static void allocation_worker_run(void* arg)
+{
+    allocation_worker* worker = arg;
+    void* blocks[LIVE_BLOCKS] = { 0 };
+    u64 sizes[LIVE_BLOCKS] = { 0 };
+    u64 range = worker->max_size - worker->min_size + 1;
+
+    for (u32 i = 0; i < ITERATIONS; ++i) {
+        u32 slot = i % LIVE_BLOCKS;
+        if (blocks[slot])
+            kfree(blocks[slot], sizes[slot], MEMORY_TAG_APPLICATION);
+
+        sizes[slot] = worker->min_size + random_next(&worker->seed) % range;
+        blocks[slot] = kallocate_uninitialized(sizes[slot], MEMORY_TAG_APPLICATION);
+        BENCH_KEEP(blocks[slot]);
+    }
+
+    for (u32 i = 0; i < LIVE_BLOCKS; ++i)
+        kfree(blocks[i], sizes[i], MEMORY_TAG_APPLICATION);
+    kmemory_thread_cache_flush();
+}
+
+static void allocation_scaling(const char* label, u64 min_size, u64 max_size)
+{
+    static const u32 thread_counts[] = { 1, 2, 4, 8 };
+    allocation_worker workers[8];
+
+    printf("kallocate/kfree pairs, %s (%llu-%lluB):\n", label, min_size, max_size);
+    for (u32 i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); ++i) {
+        u32 thread_count = thread_counts[i];
+        for (u32 j = 0; j < thread_count; ++j) {
+            workers[j].min_size = min_size;
+            workers[j].max_size = max_size;
+            workers[j].seed = j + 1;
+        }
+
+        f64 seconds = bench_run_threads(thread_count, allocation_worker_run, workers, sizeof(allocation_worker));
+        char name[64];
+        snprintf(name, sizeof(name), "%u thread(s)", thread_count);
+        bench_report(name, (u64)ITERATIONS * thread_count, seconds);
+    }
+}
+
+// Large enough that every pass over it goes out to main memory.
+#define BANDWIDTH_BUFFER_SIZE MEBIBYTES(64)
+#define BANDWIDTH_PASSES 8
+
+/**
+ * Allocates a buffer and overwrites it completely from source, the way darray growth and staging
+ * buffers use new memory. Zeroing first, once or twice, is pure overhead on top of the copy.
+ */
+static f64 overwrite_pass(const void* source, u32 zero_passes)
+{
+    f64 start = bench_time_now();
+    void* buffer = zero_passes ? kallocate(BANDWIDTH_BUFFER_SIZE, MEMORY_TAG_ARRAY) : kallocate_uninitialized(BANDWIDTH_BUFFER_SIZE, MEMORY_TAG_ARRAY);
+    // The second clear stands in for the kset_memory _darray_create used to run over a fresh allocation.
+    if (zero_passes > 1)
+        kset_memory(buffer, 0, BANDWIDTH_BUFFER_SIZE);
+    kcopy_memory(buffer, source, BANDWIDTH_BUFFER_SIZE);
+    BENCH_KEEP(buffer);
+    f64 seconds = bench_time_now() - start;
+
+    kfree(buffer, BANDWIDTH_BUFFER_SIZE, MEMORY_TAG_ARRAY);
+    return seconds;
+}
+
+static void overwrite_bandwidth()
+{
+    static const char* labels[] = { "uninitialized + copy", "zeroed once + copy", "zeroed twice + copy (old darray)" };
+
+    void* source = kallocate(BANDWIDTH_BUFFER_SIZE, MEMORY_TAG_ARRAY);
+    kset_memory(source, 0x5A, BANDWIDTH_BUFFER_SIZE);
+
+    printf("Allocate and overwrite %llu MiB, bytes copied per second:\n", BANDWIDTH_BUFFER_SIZE / MEBIBYTES(1));
+    for (u32 zero_passes = 0; zero_passes < 3; ++zero_passes) {
+        // Warm up, so the first pass does not pay for faulting pages in.
+        overwrite_pass(source, zero_passes);
+
+        f64 seconds = 0;
+        for (u32 i = 0; i < BANDWIDTH_PASSES; ++i)
+            seconds += overwrite_pass(source, zero_passes);
+        bench_report_bandwidth(labels[zero_passes], (u64)BANDWIDTH_BUFFER_SIZE * BANDWIDTH_PASSES, seconds);
+    }
+
+    kfree(source, BANDWIDTH_BUFFER_SIZE, MEMORY_TAG_ARRAY);
+}
+
+void bench_kmemory_run()
+{
+    // Served from the per-thread caches.
+    allocation_scaling("small blocks", 16, 256);
+    // Too large to cache, so every call takes the allocator lock.
+    allocation_scaling("medium blocks", 512, 2048);
+
+    overwrite_bandwidth();
+}
@@ -0,0 +1,140 @@
+#include "bench.h"
+
+#include <containers/ring_queue.h>
+
+#include <stdio.h>
+
+#if KPLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+
+#define QUEUE_CAPACITY 1024
+#define BATCH_SIZE 32
+#define TOTAL_OPERATIONS 4000000
+#define MAX_PAIRS 4
+
+typedef struct queue_bench {
+    ring_queue queue;
+    u64 per_producer;
+    u64 total;
+    b8 batched;
+    // Values dequeued so far, by every consumer together.
+    u64 consumed;
+} queue_bench;
+
+typedef struct queue_bench_thread {
+    queue_bench* bench;
+    b8 is_producer;
+} queue_bench_thread;
+
+// A thread that finds the queue full, or empty, gives up its time slice. With more threads than
+// cores, spinning would only hold up the thread it is waiting for.
+static void queue_bench_wait()
+{
+#if KPLATFORM_WINDOWS
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+static void produce(queue_bench* bench)
+{
+    u64 values[BATCH_SIZE];
+    for (u32 i = 0; i < BATCH_SIZE; ++i)
+        values[i] = i;
+
+    u64 remaining = bench->per_producer;
+    while (remaining) {
+        u64 count = bench->batched ? BATCH_SIZE : 1;
+        if (count > remaining)
+            count = remaining;
+        u64 enqueued = ring_queue_enqueue_n(&bench->queue, values, count);
+        remaining -= enqueued;
+        if (enqueued < count)
+            queue_bench_wait();
+    }
+}
+
+static void consume(queue_bench* bench)
+{
+    u64 values[BATCH_SIZE];
+    while (__atomic_load_n(&bench->consumed, __ATOMIC_RELAXED) < bench->total) {
+        u64 count = ring_queue_dequeue_n(&bench->queue, values, bench->batched ? BATCH_SIZE : 1);
+        if (!count) {
+            queue_bench_wait();
+            continue;
+        }
+        BENCH_KEEP(values[0]);
+        __atomic_add_fetch(&bench->consumed, count, __ATOMIC_RELAXED);
+    }
+}
+
+static void queue_bench_thread_run(void* arg)
+{
+    queue_bench_thread* thread = arg;
+    if (thread->is_producer)
+        produce(thread->bench);
+    else
+        consume(thread->bench);
+}
+
+// Moves TOTAL_OPERATIONS values through one queue, split evenly between pair_count producers.
+static void run_pairs(const char* name, ring_queue_mode mode, u32 pair_count, b8 batched)
+{
+    queue_bench bench = { 0 };
+    bench.per_producer = TOTAL_OPERATIONS / pair_count;
+    bench.total = bench.per_producer * pair_count;
+    bench.batched = batched;
+    if (!ring_queue_create(sizeof(u64), QUEUE_CAPACITY, mode, &bench.queue)) {
+        printf("  %s: failed to create the queue.\n", name);
+        return;
+    }
+
+    queue_bench_thread threads[MAX_PAIRS * 2];
+    for (u32 i = 0; i < pair_count * 2; ++i) {
+        threads[i].bench = &bench;
+        threads[i].is_producer = i < pair_count;
+    }
+    f64 seconds = bench_run_threads(pair_count * 2, queue_bench_thread_run, threads, sizeof(queue_bench_thread));
+    bench_report(name, bench.total, seconds);
+
+    ring_queue_destroy(&bench.queue);
+}
+
+// The same traffic on one thread, alternating between filling and draining the queue.
+static void run_single_threaded()
+{
+    ring_queue queue;
+    if (!ring_queue_create(sizeof(u64), QUEUE_CAPACITY, RING_QUEUE_MODE_SINGLE_THREADED, &queue))
+        return;
+
+    u64 value = 0;
+    f64 start = bench_time_now();
+    for (u64 done = 0; done < TOTAL_OPERATIONS; done += QUEUE_CAPACITY) {
+        for (u64 i = 0; i < QUEUE_CAPACITY; ++i)
+            ring_queue_enqueue(&queue, &i);
+        for (u64 i = 0; i < QUEUE_CAPACITY; ++i)
+            ring_queue_dequeue(&queue, &value);
+        BENCH_KEEP(value);
+    }
+    bench_report("single-threaded, 1 thread", TOTAL_OPERATIONS, bench_time_now() - start);
+
+    ring_queue_destroy(&queue);
+}
+
+void bench_ring_queue_run()
+{
+    printf("Moving %u values through a ring queue of %u, enqueue and dequeue counted as one:\n", TOTAL_OPERATIONS, QUEUE_CAPACITY);
+
+    run_single_threaded();
+    run_pairs("SPSC, 1 pair", RING_QUEUE_MODE_SPSC, 1, FALSE);
+    run_pairs("SPSC, 1 pair, batches of 32", RING_QUEUE_MODE_SPSC, 1, TRUE);
+
+    static const char* mpmc_labels[] = { "MPMC, 1 pair", "MPMC, 2 pairs", "MPMC, 4 pairs" };
+    for (u32 pairs = 1, label = 0; pairs <= MAX_PAIRS; pairs *= 2, ++label)
+        run_pairs(mpmc_labels[label], RING_QUEUE_MODE_MPMC, pairs, FALSE);
+    run_pairs("MPMC, 4 pairs, batches of 32", RING_QUEUE_MODE_MPMC, MAX_PAIRS, TRUE);
+}
@@ -0,0 +1,24 @@
+#include <core/kmemory.h>
+
+#include "bench.h"
+
+#include <stdio.h>
+
+int main(void)
+{
+    memory_system_configuration memory_config = {
+        .total_alloc_size = MEBIBYTES(512),
+    };
+
+    if (!initialize_memory(memory_config)) {
+        printf("Failed to initialize the memory system!\n");
+        return 1;
+    }
+
+    bench_kmemory_run();
+    bench_darray_run();
+    bench_ring_queue_run();
+
+    shutdown_memory();
+    return 0;
+}
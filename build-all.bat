@@ -15,4 +15,16 @@ popd
 
 if %ERRORLEVEL% neq 0 (echo Error: %ERRORLEVEL% && exit)
 
+pushd tests
+call build.bat
+popd
+
+if %ERRORLEVEL% neq 0 (echo Error: %ERRORLEVEL% && exit)
+
+pushd benchmarks
+call build.bat
+popd
+
+if %ERRORLEVEL% neq 0 (echo Error: %ERRORLEVEL% && exit)
+
 echo "All assemblies built successfully."
@@ -15,7 +15,7 @@ set compilerFlags=-g -shared -Wvarargs -Wall -Werror
 
 set includeFlags=-Isrc -I%VULKAN_SDK%/Include
 
-set linkerFlags=-luser32 -lvulkan-1 -L%VULKAN_SDK%/Lib
+set linkerFlags=-luser32 -ladvapi32 -lvulkan-1 -L%VULKAN_SDK%/Lib
 
 set defines=-D_DEBUG -DKEXPORT -D_CRT_SECURE_NO_WARNINGS
 
@@ -0,0 +1,214 @@
+#include "bitset.h"
+
+#include "core/kmemory.h"
+#include "core/logger.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Words are allocated in whole 256-bit blocks, the widest vector used below.
+#define BLOCK_WORDS 4
+#define WORDS_ALIGNMENT 32
+
+static u64 word_count_for(u64 bit_count)
+{
+    u64 words = (bit_count + 63) / 64;
+    return (words + BLOCK_WORDS - 1) & ~(u64)(BLOCK_WORDS - 1);
+}
+
+typedef enum bitset_op {
+    BITSET_OP_AND,
+    BITSET_OP_OR,
+    BITSET_OP_XOR,
+    BITSET_OP_ANDNOT
+} bitset_op;
+
+#if defined(__AVX2__)
+#define VECTOR_WORDS 4
+#define VECTOR_LOOP(op)                                                    \
+    for (u64 i = 0; i < count; i += VECTOR_WORDS) {                        \
+        __m256i x = _mm256_load_si256((const __m256i*)&a[i]);              \
+        __m256i y = _mm256_load_si256((const __m256i*)&b[i]);              \
+        _mm256_store_si256((__m256i*)&out[i], op);                         \
+    }
+#define VECTOR_AND _mm256_and_si256(x, y)
+#define VECTOR_OR _mm256_or_si256(x, y)
+#define VECTOR_XOR _mm256_xor_si256(x, y)
+#define VECTOR_ANDNOT _mm256_andnot_si256(y, x)
+#elif BITSET_SSE2
+#define VECTOR_WORDS 2
+#define VECTOR_LOOP(op)                                                    \
+    for (u64 i = 0; i < count; i += VECTOR_WORDS) {                        \
+        __m128i x = _mm_load_si128((const __m128i*)&a[i]);                 \
+        __m128i y = _mm_load_si128((const __m128i*)&b[i]);                 \
+        _mm_store_si128((__m128i*)&out[i], op);                            \
+    }
+#define VECTOR_AND _mm_and_si128(x, y)
+#define VECTOR_OR _mm_or_si128(x, y)
+#define VECTOR_XOR _mm_xor_si128(x, y)
+#define VECTOR_ANDNOT _mm_andnot_si128(y, x)
+#else
+#define VECTOR_WORDS 1
+#define VECTOR_LOOP(op)                   \
+    for (u64 i = 0; i < count; ++i) {     \
+        u64 x = a[i];                     \
+        u64 y = b[i];                     \
+        out[i] = op;                      \
+    }
+#define VECTOR_AND (x & y)
+#define VECTOR_OR (x | y)
+#define VECTOR_XOR (x ^ y)
+#define VECTOR_ANDNOT (x & ~y)
+#endif
+
+static void words_apply(u64* out, const u64* a, const u64* b, u64 count, bitset_op op)
+{
+    switch (op) {
+        case BITSET_OP_AND:
+            VECTOR_LOOP(VECTOR_AND);
+            break;
+        case BITSET_OP_OR:
+            VECTOR_LOOP(VECTOR_OR);
+            break;
+        case BITSET_OP_XOR:
+            VECTOR_LOOP(VECTOR_XOR);
+            break;
+        case BITSET_OP_ANDNOT:
+            VECTOR_LOOP(VECTOR_ANDNOT);
+            break;
+    }
+}
+
+static b8 bitset_apply(bitset* out, const bitset* a, const bitset* b, bitset_op op)
+{
+    if (a->bit_count != b->bit_count || out->bit_count != a->bit_count) {
+        KERROR("bitset operations require sets of the same size, got %llu, %llu and %llu bits.", out->bit_count, a->bit_count, b->bit_count);
+        return FALSE;
+    }
+
+    // Bits past bit_count are clear in both inputs, and every op keeps them clear.
+    words_apply(out->words, a->words, b->words, a->word_count, op);
+    return TRUE;
+}
+
+b8 bitset_create(u64 bit_count, bitset* out_set)
+{
+    if (!out_set) {
+        KERROR("bitset_create requires a valid pointer to hold the set.");
+        return FALSE;
+    }
+
+    kzero_memory(out_set, sizeof(bitset));
+    out_set->bit_count = bit_count;
+    out_set->word_count = word_count_for(bit_count);
+    if (out_set->word_count) {
+        out_set->words = kallocate_aligned(out_set->word_count * sizeof(u64), WORDS_ALIGNMENT, MEMORY_TAG_ARRAY);
+        if (!out_set->words)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+void bitset_destroy(bitset* set)
+{
+    if (!set)
+        return;
+
+    if (set->words)
+        kfree_aligned(set->words, set->word_count * sizeof(u64), WORDS_ALIGNMENT, MEMORY_TAG_ARRAY);
+    kzero_memory(set, sizeof(bitset));
+}
+
+b8 bitset_resize(bitset* set, u64 bit_count)
+{
+    u64 word_count = word_count_for(bit_count);
+    if (word_count != set->word_count) {
+        u64* words = 0;
+        if (word_count) {
+            words = kallocate_aligned(word_count * sizeof(u64), WORDS_ALIGNMENT, MEMORY_TAG_ARRAY);
+            if (!words)
+                return FALSE;
+            u64 kept = word_count < set->word_count ? word_count : set->word_count;
+            kcopy_memory(words, set->words, kept * sizeof(u64));
+        }
+
+        if (set->words)
+            kfree_aligned(set->words, set->word_count * sizeof(u64), WORDS_ALIGNMENT, MEMORY_TAG_ARRAY);
+        set->words = words;
+        set->word_count = word_count;
+    }
+
+    // Bits cut off by shrinking must not come back if it grows again.
+    if (bit_count < set->bit_count && bit_count % 64)
+        set->words[bit_count / 64] &= (1ULL << (bit_count % 64)) - 1;
+    for (u64 i = (bit_count + 63) / 64; i < set->word_count && i < (set->bit_count + 63) / 64; ++i)
+        set->words[i] = 0;
+
+    set->bit_count = bit_count;
+    return TRUE;
+}
+
+void bitset_clear_all(bitset* set)
+{
+    if (set->words)
+        kzero_memory(set->words, set->word_count * sizeof(u64));
+}
+
+b8 bitset_and(bitset* out, const bitset* a, const bitset* b)
+{
+    return bitset_apply(out, a, b, BITSET_OP_AND);
+}
+
+b8 bitset_or(bitset* out, const bitset* a, const bitset* b)
+{
+    return bitset_apply(out, a, b, BITSET_OP_OR);
+}
+
+b8 bitset_xor(bitset* out, const bitset* a, const bitset* b)
+{
+    return bitset_apply(out, a, b, BITSET_OP_XOR);
+}
+
+b8 bitset_andnot(bitset* out, const bitset* a, const bitset* b)
+{
+    return bitset_apply(out, a, b, BITSET_OP_ANDNOT);
+}
+
+u64 bitset_popcount(const bitset* set)
+{
+    u64 count = 0;
+    for (u64 i = 0; i < set->word_count; ++i)
+        count += __builtin_popcountll(set->words[i]);
+    return count;
+}
+
+b8 bitset_contains_all(const bitset* set, const bitset* mask)
+{
+    if (set->bit_count != mask->bit_count) {
+        KERROR("bitset_contains_all requires sets of the same size, got %llu and %llu bits.", set->bit_count, mask->bit_count);
+        return FALSE;
+    }
+
+    u64 missing = 0;
+    for (u64 i = 0; i < set->word_count; ++i)
+        missing |= mask->words[i] & ~set->words[i];
+    return missing == 0;
+}
+
+i64 bitset_next(const bitset* set, u64 from)
+{
+    if (from >= set->bit_count)
+        return -1;
+
+    u64 word = from >> 6;
+    u64 bits = set->words[word] & (~0ULL << (from & 63));
+    for (;;) {
+        if (bits)
+            return (i64)(word * 64 + __builtin_ctzll(bits));
+        if (++word == set->word_count)
+            return -1;
+        bits = set->words[word];
+    }
+}
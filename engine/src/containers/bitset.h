@@ -0,0 +1,210 @@
+#pragma once
+
+#include "defines.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define BITSET_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/**
+ * A fixed set of 256 bits, e.g. one per key code or component type. Small enough to live inline
+ * and be copied by value. The set operations are inlined and take two SSE2 instructions each.
+ */
+typedef struct bitset256 {
+    _Alignas(16) u64 words[4];
+} bitset256;
+
+static inline b8 bitset256_test(const bitset256* set, u32 bit)
+{
+    return (set->words[bit >> 6] >> (bit & 63)) & 1;
+}
+
+static inline void bitset256_set(bitset256* set, u32 bit)
+{
+    set->words[bit >> 6] |= 1ULL << (bit & 63);
+}
+
+static inline void bitset256_clear(bitset256* set, u32 bit)
+{
+    set->words[bit >> 6] &= ~(1ULL << (bit & 63));
+}
+
+static inline void bitset256_assign(bitset256* set, u32 bit, b8 value)
+{
+    if (value)
+        bitset256_set(set, bit);
+    else
+        bitset256_clear(set, bit);
+}
+
+#if BITSET_SSE2
+#define BITSET256_OP(out, a, b, op)                                                                       \
+    {                                                                                                     \
+        const __m128i* _a = (const __m128i*)(a)->words;                                                   \
+        const __m128i* _b = (const __m128i*)(b)->words;                                                   \
+        __m128i* _out = (__m128i*)(out)->words;                                                           \
+        __m128i _low = op(_mm_load_si128(&_a[0]), _mm_load_si128(&_b[0]));                                \
+        __m128i _high = op(_mm_load_si128(&_a[1]), _mm_load_si128(&_b[1]));                               \
+        _mm_store_si128(&_out[0], _low);                                                                  \
+        _mm_store_si128(&_out[1], _high);                                                                 \
+    }
+// SSE2's andnot negates its first operand.
+#define BITSET_SSE2_ANDNOT(a, b) _mm_andnot_si128(b, a)
+#endif
+
+// out = a & b. out may be either of the inputs.
+static inline void bitset256_and(bitset256* out, const bitset256* a, const bitset256* b)
+{
+#if BITSET_SSE2
+    BITSET256_OP(out, a, b, _mm_and_si128);
+#else
+    for (u32 i = 0; i < 4; ++i)
+        out->words[i] = a->words[i] & b->words[i];
+#endif
+}
+
+// out = a | b. out may be either of the inputs.
+static inline void bitset256_or(bitset256* out, const bitset256* a, const bitset256* b)
+{
+#if BITSET_SSE2
+    BITSET256_OP(out, a, b, _mm_or_si128);
+#else
+    for (u32 i = 0; i < 4; ++i)
+        out->words[i] = a->words[i] | b->words[i];
+#endif
+}
+
+// out = a ^ b, the bits that differ. out may be either of the inputs.
+static inline void bitset256_xor(bitset256* out, const bitset256* a, const bitset256* b)
+{
+#if BITSET_SSE2
+    BITSET256_OP(out, a, b, _mm_xor_si128);
+#else
+    for (u32 i = 0; i < 4; ++i)
+        out->words[i] = a->words[i] ^ b->words[i];
+#endif
+}
+
+// out = a & ~b, the bits of a that are not in b. out may be either of the inputs.
+static inline void bitset256_andnot(bitset256* out, const bitset256* a, const bitset256* b)
+{
+#if BITSET_SSE2
+    BITSET256_OP(out, a, b, BITSET_SSE2_ANDNOT);
+#else
+    for (u32 i = 0; i < 4; ++i)
+        out->words[i] = a->words[i] & ~b->words[i];
+#endif
+}
+
+static inline u32 bitset256_popcount(const bitset256* set)
+{
+    return __builtin_popcountll(set->words[0]) + __builtin_popcountll(set->words[1])
+           + __builtin_popcountll(set->words[2]) + __builtin_popcountll(set->words[3]);
+}
+
+static inline b8 bitset256_any(const bitset256* set)
+{
+    return (set->words[0] | set->words[1] | set->words[2] | set->words[3]) != 0;
+}
+
+// TRUE if every bit of mask is also set in set, e.g. an entity having every component a system needs.
+static inline b8 bitset256_contains_all(const bitset256* set, const bitset256* mask)
+{
+    return ((mask->words[0] & ~set->words[0]) | (mask->words[1] & ~set->words[1])
+            | (mask->words[2] & ~set->words[2]) | (mask->words[3] & ~set->words[3]))
+           == 0;
+}
+
+/**
+ * Finds the first set bit at or after from. To visit every set bit:
+ * for (i32 bit = bitset256_next(&set, 0); bit >= 0; bit = bitset256_next(&set, bit + 1))
+ * @param set A pointer to the set.
+ * @param from The bit to start searching at.
+ * @returns The index of the bit, or -1 if there are no more set bits.
+ */
+static inline i32 bitset256_next(const bitset256* set, u32 from)
+{
+    if (from >= 256)
+        return -1;
+
+    u32 word = from >> 6;
+    u64 bits = set->words[word] & (~0ULL << (from & 63));
+    for (;;) {
+        if (bits)
+            return (i32)(word * 64 + __builtin_ctzll(bits));
+        if (++word == 4)
+            return -1;
+        bits = set->words[word];
+    }
+}
+
+/**
+ * A set of any number of bits, allocated on the heap. The words are padded to a whole number of
+ * vectors, so the bulk operations never need a scalar tail.
+ */
+typedef struct bitset {
+    u64* words;
+    u64 word_count;
+    u64 bit_count;
+} bitset;
+
+/**
+ * Creates a bitset with every bit cleared.
+ * @param bit_count The number of bits.
+ * @param out_set A pointer to hold the created set.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 bitset_create(u64 bit_count, bitset* out_set);
+
+/**
+ * Destroys a bitset.
+ * @param set A pointer to the set to be destroyed.
+ */
+KAPI void bitset_destroy(bitset* set);
+
+/**
+ * Changes the number of bits, keeping the value of the bits that remain. New bits are cleared.
+ * @param set A pointer to the set.
+ * @param bit_count The new number of bits.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 bitset_resize(bitset* set, u64 bit_count);
+
+// Clears every bit.
+KAPI void bitset_clear_all(bitset* set);
+
+// The set operations require every set to have the same number of bits. out may be either input.
+KAPI b8 bitset_and(bitset* out, const bitset* a, const bitset* b);
+KAPI b8 bitset_or(bitset* out, const bitset* a, const bitset* b);
+KAPI b8 bitset_xor(bitset* out, const bitset* a, const bitset* b);
+// out = a & ~b.
+KAPI b8 bitset_andnot(bitset* out, const bitset* a, const bitset* b);
+
+KAPI u64 bitset_popcount(const bitset* set);
+
+// TRUE if every bit of mask is also set in set. Both must have the same number of bits.
+KAPI b8 bitset_contains_all(const bitset* set, const bitset* mask);
+
+/**
+ * Finds the first set bit at or after from.
+ * @param set A pointer to the set.
+ * @param from The bit to start searching at.
+ * @returns The index of the bit, or -1 if there are no more set bits.
+ */
+KAPI i64 bitset_next(const bitset* set, u64 from);
+
+static inline b8 bitset_test(const bitset* set, u64 bit)
+{
+    return (set->words[bit >> 6] >> (bit & 63)) & 1;
+}
+
+static inline void bitset_set(bitset* set, u64 bit)
+{
+    set->words[bit >> 6] |= 1ULL << (bit & 63);
+}
+
+static inline void bitset_clear(bitset* set, u64 bit)
+{
+    set->words[bit >> 6] &= ~(1ULL << (bit & 63));
+}
@@ -2,28 +2,35 @@
 #include "core/kmemory.h"
 #include "core/logger.h"
 
-void* _darray_create(u64 length, u64 stride)
+static void* darray_allocate(u64 length, u64 stride, b8 zero_memory)
 {
-    u64 header_size = DARRAY_FIELD_LENGTH * sizeof(u64);
     u64 array_size = length * stride;
 
-    u64* new_array = kallocate(header_size + array_size, MEMORY_TAG_DARRAY);
+    darray_header* header = zero_memory
+        ? kallocate(sizeof(darray_header) + array_size, MEMORY_TAG_DARRAY)
+        : kallocate_uninitialized(sizeof(darray_header) + array_size, MEMORY_TAG_DARRAY);
+    if (!header) {
+        KERROR("darray - unable to allocate an array with a capacity of %llu.", length);
+        return 0;
+    }
 
-    kset_memory(new_array, 0, header_size + array_size);
+    header->capacity = length;
+    header->length = 0;
+    header->stride = stride;
+    header->growth = DARRAY_RESIZE_FACTOR * 100;
 
-    new_array[DARRAY_CAPACITY] = length;
-    new_array[DARRAY_LENGTH] = 0;
-    new_array[DARRAY_STRIDE] = stride;
+    return (void*)(header + 1);
+}
 
-    return (void*)(new_array + DARRAY_FIELD_LENGTH);
+void* _darray_create(u64 length, u64 stride)
+{
+    return darray_allocate(length, stride, TRUE);
 }
 
 void _darray_destroy(void* array)
 {
-    u64* header = (u64*)array - DARRAY_FIELD_LENGTH;
-
-    u64 header_size = DARRAY_FIELD_LENGTH * sizeof(u64);
-    u64 total_size = header_size + header[DARRAY_CAPACITY] * header[DARRAY_STRIDE];
+    darray_header* header = _darray_header(array);
+    u64 total_size = sizeof(darray_header) + header->capacity * header->stride;
 
     kfree(header, total_size, MEMORY_TAG_DARRAY);
 }
@@ -40,17 +47,67 @@ void _darray_field_set(void* array, u64 field, u64 value)
     header[field] = value;
 }
 
+/**
+ * Reallocates the array to hold exactly capacity elements, in place if the allocator can manage it.
+ * Returns the array, which may have moved, or 0/NULL if the memory could not be had, in which case
+ * the array is left as it was.
+ */
+static void* darray_set_capacity(void* array, u64 capacity)
+{
+    darray_header* header = _darray_header(array);
+    u64 old_size = sizeof(darray_header) + header->capacity * header->stride;
+    u64 new_size = sizeof(darray_header) + capacity * header->stride;
+
+    // Capacity gained here is not zeroed, nothing may read past the length anyway.
+    header = kreallocate(header, old_size, new_size, MEMORY_TAG_DARRAY);
+    if (!header) {
+        KERROR("darray - unable to resize array to a capacity of %llu.", capacity);
+        return 0;
+    }
+
+    header->capacity = capacity;
+    return (void*)(header + 1);
+}
+
+// The capacity to grow to in order to fit at least required elements.
+static u64 darray_grown_capacity(const darray_header* header, u64 required)
+{
+    u64 capacity = header->capacity * header->growth / 100;
+    if (capacity <= header->capacity)
+        capacity = header->capacity + 1;
+    return capacity < required ? required : capacity;
+}
+
+// Grows the array to fit at least required elements. Returns 0/NULL on failure, see darray_set_capacity.
+static void* darray_grow(void* array, u64 required)
+{
+    return darray_set_capacity(array, darray_grown_capacity(_darray_header(array), required));
+}
+
 void* _darray_resize(void* array)
 {
-    u64 length = darray_length(array);
-    u64 stride = darray_stride(array);
+    void* grown = darray_grow(array, darray_capacity(array) + 1);
+    return grown ? grown : array;
+}
 
-    void* temp = _darray_create(DARRAY_RESIZE_FACTOR * darray_capacity(array), stride);
-    kcopy_memory(temp, array, length * stride);
-    _darray_field_set(temp, DARRAY_LENGTH, length);
+void* _darray_ensure_capacity(void* array, u64 capacity)
+{
+    if (capacity <= darray_capacity(array))
+        return array;
 
-    _darray_destroy(array);
-    return temp;
+    void* grown = darray_set_capacity(array, capacity);
+    return grown ? grown : array;
+}
+
+void* _darray_shrink_to_fit(void* array)
+{
+    u64 length = darray_length(array);
+    u64 capacity = length ? length : 1;
+    if (capacity >= darray_capacity(array))
+        return array;
+
+    void* shrunk = darray_set_capacity(array, capacity);
+    return shrunk ? shrunk : array;
 }
 
 void* _darray_push(void* array, const void* value_ptr)
@@ -58,14 +115,46 @@ void* _darray_push(void* array, const void* value_ptr)
     u64 length = darray_length(array);
     u64 stride = darray_stride(array);
 
-    if (length >= darray_capacity(array))
-        array = _darray_resize(array);
+    if (length >= darray_capacity(array)) {
+        void* grown = darray_grow(array, length + 1);
+        if (!grown)
+            return array;
+        array = grown;
+    }
 
     u64 addr = (u64)array;
     addr += (length * stride);
     kcopy_memory((void*)addr, value_ptr, stride);
-    _darray_field_set(array, DARRAY_LENGTH, length + 1);
+    darray_length_set(array, length + 1);
+
+    return array;
+}
+
+void* _darray_push_n(void* array, const void* values, u64 count)
+{
+    darray_header* header = _darray_header(array);
+    u64 length = header->length;
+    u64 stride = header->stride;
+
+    if (count == 0)
+        return array;
+
+    if (length + count > header->capacity) {
+        // The source may be the array itself, which is about to move.
+        u64 array_start = (u64)array;
+        b8 aliased = (u64)values >= array_start && (u64)values < array_start + header->capacity * stride;
+        u64 values_offset = (u64)values - array_start;
+
+        void* grown = darray_grow(array, length + count);
+        if (!grown)
+            return array;
+        array = grown;
+        if (aliased)
+            values = (u8*)array + values_offset;
+    }
 
+    kcopy_memory((u8*)array + length * stride, values, count * stride);
+    darray_length_set(array, length + count);
     return array;
 }
 
@@ -74,65 +163,100 @@ void _darray_pop(void* array, void* dest)
     u64 length = darray_length(array);
     u64 stride = darray_stride(array);
 
-    u64 addr = (u64)array;
-    addr += (length - 1) * stride;
+    if (length == 0) {
+        KERROR("darray_pop called on an empty array.");
+        return;
+    }
 
-    kcopy_memory(dest, (void*)addr, length - 1);
-    _darray_field_set(array, DARRAY_LENGTH, length - 1);
+    if (dest)
+        kcopy_memory(dest, (u8*)array + (length - 1) * stride, stride);
+    darray_length_set(array, length - 1);
 }
 
-KAPI void* _darray_pop_at(void* array, u64 index, void* dest)
+void* _darray_pop_at(void* array, u64 index, void* dest)
 {
     u64 length = darray_length(array);
     u64 stride = darray_stride(array);
 
     if (index >= length) {
-        KERROR("Index outside the bounds of this array! Length: %i, index: %i", length, index);
+        KERROR("Index outside the bounds of this array! Length: %llu, index: %llu", length, index);
         return array;
     }
 
-    u64 addr = (u64)array;
-    kcopy_memory(dest, (void*)(addr + (index * stride)), stride);
-
-    // If not the last element, snip out the entry and copy the rest inward.
-    if (index != length - 1) {
-        kcopy_memory(
-            (void*)(addr + (index * stride)),
-            (void*)(addr + ((index + 1) * stride)),
-            stride * (length - index));
-    }
+    u8* element = (u8*)array + index * stride;
+    if (dest)
+        kcopy_memory(dest, element, stride);
 
-    _darray_field_set(array, DARRAY_LENGTH, length - 1);
+    // Close the gap by shifting everything after the element inward.
+    kmove_memory(element, element + stride, (length - index - 1) * stride);
+
+    darray_length_set(array, length - 1);
     return array;
 }
 
-void* _darray_insert_index(void* array, u64 index, void* value_ptr)
+void* _darray_swap_remove(void* array, u64 index, void* dest)
 {
     u64 length = darray_length(array);
     u64 stride = darray_stride(array);
 
     if (index >= length) {
-        KERROR("Index outside the bounds of this array! Length: %i, index: %i", length, index);
+        KERROR("Index outside the bounds of this array! Length: %llu, index: %llu", length, index);
         return array;
     }
 
-    if (length >= darray_capacity(array)) {
-        array = _darray_resize(array);
+    u8* element = (u8*)array + index * stride;
+    if (dest)
+        kcopy_memory(dest, element, stride);
+
+    // Fill the hole with the last element instead of shifting everything after it.
+    if (index != length - 1)
+        kcopy_memory(element, (u8*)array + (length - 1) * stride, stride);
+
+    darray_length_set(array, length - 1);
+    return array;
+}
+
+void* _darray_erase_range(void* array, u64 index, u64 count)
+{
+    u64 length = darray_length(array);
+    u64 stride = darray_stride(array);
+
+    if (index > length || count > length - index) {
+        KERROR("Range outside the bounds of this array! Length: %llu, index: %llu, count: %llu", length, index, count);
+        return array;
     }
 
-    u64 addr = (u64)array;
+    u8* start = (u8*)array + index * stride;
+    kmove_memory(start, start + count * stride, (length - index - count) * stride);
 
-    // If not the last element, copy the rest outward
-    if (index != length - 1) {
-        kcopy_memory(
-            (void*)(addr + ((index + 1) * stride)),
-            (void*)(addr + (index * stride)),
-            stride * (length - index));
+    darray_length_set(array, length - count);
+    return array;
+}
+
+void* _darray_insert_at(void* array, u64 index, const void* value_ptr)
+{
+    u64 length = darray_length(array);
+    u64 stride = darray_stride(array);
+
+    // Inserting at the length appends.
+    if (index > length) {
+        KERROR("Index outside the bounds of this array! Length: %llu, index: %llu", length, index);
+        return array;
+    }
+
+    if (length >= darray_capacity(array)) {
+        void* grown = darray_grow(array, length + 1);
+        if (!grown)
+            return array;
+        array = grown;
     }
 
-    // Set the value at index
-    kcopy_memory((void*)(addr + (index * stride)), value_ptr, stride);
+    // Make room by shifting everything from the index outward.
+    u8* element = (u8*)array + index * stride;
+    kmove_memory(element + stride, element, (length - index) * stride);
 
-    _darray_field_set(array, DARRAY_LENGTH, length + 1);
+    kcopy_memory(element, value_ptr, stride);
+
+    darray_length_set(array, length + 1);
     return array;
-}
\ No newline at end of file
+}
@@ -6,24 +6,78 @@ enum {
     DARRAY_CAPACITY, // How many elements will fit without resizing
     DARRAY_LENGTH, // The number of elements stored in the array
     DARRAY_STRIDE, // The size in bytes of each element
+    DARRAY_GROWTH, // The factor capacity grows by on resize, in percent
 
     DARRAY_FIELD_LENGTH
 };
 
+/**
+ * Sits right in front of the first element. Laid out in the order of the field enum above, so
+ * _darray_field_get/_darray_field_set keep working for code built against them.
+ */
+typedef struct darray_header {
+    u64 capacity;
+    u64 length;
+    u64 stride;
+    u64 growth;
+} darray_header;
+
+STATIC_ASSERT(sizeof(darray_header) == DARRAY_FIELD_LENGTH * sizeof(u64), "darray_header must match the darray field layout.");
+
+static inline darray_header* _darray_header(const void* array)
+{
+    return (darray_header*)array - 1;
+}
+
+// Creates a zeroed array, or returns 0/NULL if the memory cannot be had. Capacity gained later through resizing is NOT zeroed.
 KAPI void* _darray_create(u64 length, u64 stride);
 KAPI void _darray_destroy(void* array);
 
 KAPI u64 _darray_field_get(void* array, u64 field);
 KAPI void _darray_field_set(void* array, u64 field, u64 value);
 
+/**
+ * Functions that grow the array return it, as it may have moved. If the memory cannot be had, an
+ * error is logged, nothing is added, and the array is returned exactly as it was.
+ */
 KAPI void* _darray_resize(void* array);
 
+/**
+ * Makes sure the array can hold at least capacity elements without resizing again.
+ * @param array The array.
+ * @param capacity The number of elements the array should fit.
+ * @returns The array, which may have moved.
+ */
+KAPI void* _darray_ensure_capacity(void* array, u64 capacity);
+
+// Shrinks the capacity down to the length, releasing the unused tail. Returns the array, which may have moved.
+KAPI void* _darray_shrink_to_fit(void* array);
+
 KAPI void* _darray_push(void* array, const void* value_ptr);
 
+/**
+ * Appends count elements in one go, resizing at most once.
+ * @param array The array.
+ * @param values A pointer to count elements of the array's stride. May point into the array itself.
+ * @param count The number of elements to append.
+ * @returns The array, which may have moved.
+ */
+KAPI void* _darray_push_n(void* array, const void* values, u64 count);
+
+// Removes the last element, copying it to dest unless dest is 0/NULL.
 KAPI void _darray_pop(void* array, void* dest);
 
+// Removes the element at index, copying it to dest unless dest is 0/NULL. Later elements shift down, keeping their order.
 KAPI void* _darray_pop_at(void* array, u64 index, void* dest);
-KAPI void* _darray_insert_index(void* array, u64 index, void* value_ptr);
+
+// Removes the element at index in O(1) by moving the last element into its place. Does not keep the order.
+KAPI void* _darray_swap_remove(void* array, u64 index, void* dest);
+
+// Removes count elements starting at index. Later elements shift down, keeping their order.
+KAPI void* _darray_erase_range(void* array, u64 index, u64 count);
+
+// Inserts a copy of the value at index, shifting later elements up. An index equal to the length appends.
+KAPI void* _darray_insert_at(void* array, u64 index, const void* value_ptr);
 
 #define DARRAY_DEFAULT_CAPACITY 1
 #define DARRAY_RESIZE_FACTOR 2
@@ -44,6 +98,19 @@ KAPI void* _darray_insert_index(void* array, u64 index, void* value_ptr);
 
 // NOTE: could use __auto_type for the temp above. Both __auto_type and typeof() are GNU extensions
 
+#define darray_push_n(array, values, count) \
+    (array = _darray_push_n(array, values, count))
+
+// Appends every element of another darray of the same type.
+#define darray_append_range(array, other) \
+    (array = _darray_push_n(array, other, darray_length(other)))
+
+#define darray_ensure_capacity(array, capacity) \
+    (array = _darray_ensure_capacity(array, capacity))
+
+#define darray_shrink_to_fit(array) \
+    (array = _darray_shrink_to_fit(array))
+
 #define darray_pop(array, value_ptr) \
     _darray_pop(array, value_ptr)
 
@@ -56,17 +123,100 @@ KAPI void* _darray_insert_index(void* array, u64 index, void* value_ptr);
 #define darray_pop_at(array, index, value_ptr) \
     _darray_pop_at(array, index, value_ptr)
 
+#define darray_swap_remove(array, index, value_ptr) \
+    _darray_swap_remove(array, index, value_ptr)
+
+#define darray_erase_range(array, index, count) \
+    _darray_erase_range(array, index, count)
+
+// The accessors read the header directly, rather than calling across the library boundary.
 #define darray_clear(array) \
-    _darray_field_set(array, DARRAY_LENGTH, 0)
+    (_darray_header(array)->length = 0)
 
 #define darray_capacity(array) \
-    _darray_field_get(array, DARRAY_CAPACITY)
+    (_darray_header(array)->capacity)
 
 #define darray_length(array) \
-    _darray_field_get(array, DARRAY_LENGTH)
+    (_darray_header(array)->length)
 
 #define darray_stride(array) \
-    _darray_field_get(array, DARRAY_STRIDE)
+    (_darray_header(array)->stride)
 
 #define darray_length_set(array, value) \
-    _darray_field_set(array, DARRAY_LENGTH, value)
+    (_darray_header(array)->length = (value))
+
+// Sets how much the capacity grows by when the array runs out of room, in percent. Anything below 101 still grows by at least one element.
+#define darray_growth_set(array, percent) \
+    (_darray_header(array)->growth = (percent))
+
+/**
+ * Generates darray functions specialized for a single element type, for hot paths. Sizes and
+ * copies are known at compile time, so the compiler can inline and vectorize them instead of
+ * going through the stride and an opaque copy. The arrays are ordinary darrays, so the generic
+ * macros above work on them too. For example, DARRAY_DEFINE(vec3) generates darray_vec3_create,
+ * darray_vec3_push, darray_vec3_insert and so on. Types that are not a single identifier, such
+ * as pointers, need a name of their own: DARRAY_DEFINE_NAMED(const char*, cstr).
+ */
+#define DARRAY_DEFINE(type) DARRAY_DEFINE_NAMED(type, type)
+
+#define DARRAY_DEFINE_NAMED(type, name)                                                \
+    /* Lets const apply to the element itself, even when the type is a pointer. */     \
+    typedef type darray_##name##_element;                                              \
+                                                                                       \
+    static inline type* darray_##name##_create(u64 capacity)                           \
+    {                                                                                  \
+        return (type*)_darray_create(capacity ? capacity : 1, sizeof(type));           \
+    }                                                                                  \
+                                                                                       \
+    static inline type* darray_##name##_push(type* array, type value)                  \
+    {                                                                                  \
+        if (_darray_header(array)->length >= _darray_header(array)->capacity) {        \
+            array = (type*)_darray_resize(array);                                      \
+            if (_darray_header(array)->length >= _darray_header(array)->capacity)      \
+                return array; /* Could not grow, already reported. */                  \
+        }                                                                              \
+        array[_darray_header(array)->length++] = value;                                \
+        return array;                                                                  \
+    }                                                                                  \
+                                                                                       \
+    static inline type darray_##name##_get(const darray_##name##_element* array,       \
+                                           u64 index)                                  \
+    {                                                                                  \
+        return array[index];                                                           \
+    }                                                                                  \
+                                                                                       \
+    static inline void darray_##name##_set(type* array, u64 index, type value)         \
+    {                                                                                  \
+        array[index] = value;                                                          \
+    }                                                                                  \
+                                                                                       \
+    /* The array must not be empty. */                                                 \
+    static inline type darray_##name##_pop(type* array)                                \
+    {                                                                                  \
+        return array[--_darray_header(array)->length];                                 \
+    }                                                                                  \
+                                                                                       \
+    static inline type* darray_##name##_insert(type* array, u64 index, type value)     \
+    {                                                                                  \
+        u64 length = _darray_header(array)->length;                                    \
+        if (index > length)                                                            \
+            return (type*)_darray_insert_at(array, index, &value); /* Reports it. */   \
+        if (length >= _darray_header(array)->capacity) {                               \
+            array = (type*)_darray_resize(array);                                      \
+            if (length >= _darray_header(array)->capacity)                             \
+                return array; /* Could not grow, already reported. */                  \
+        }                                                                              \
+        for (u64 i = length; i > index; --i)                                           \
+            array[i] = array[i - 1];                                                   \
+        array[index] = value;                                                          \
+        _darray_header(array)->length = length + 1;                                    \
+        return array;                                                                  \
+    }                                                                                  \
+                                                                                       \
+    /* Removes the element at index, moving the last one into its place. */            \
+    static inline type darray_##name##_swap_remove(type* array, u64 index)             \
+    {                                                                                  \
+        type removed = array[index];                                                   \
+        array[index] = array[--_darray_header(array)->length];                         \
+        return removed;                                                                \
+    }
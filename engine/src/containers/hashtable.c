@@ -0,0 +1,399 @@
+#include "hashtable.h"
+
+#include "core/kmemory.h"
+#include "core/kstring.h"
+#include "core/logger.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define HASHTABLE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Metadata byte states. Occupied slots hold the low 7 bits of their hash instead, so only free
+// slots have the top bit set.
+#define SLOT_EMPTY 0x80
+#define SLOT_DELETED 0xFE
+
+#define SLOT_NOT_FOUND ((u64)-1)
+
+// The table grows once it is 7/8 full.
+static u64 max_load(u64 capacity)
+{
+    return capacity - capacity / 8;
+}
+
+static u64 capacity_for(u64 count)
+{
+    u64 capacity = HASHTABLE_GROUP_WIDTH;
+    while (max_load(capacity) < count)
+        capacity *= 2;
+    return capacity;
+}
+
+// Keeps elements naturally aligned for anything up to 8 bytes.
+static u64 element_stride(u64 size)
+{
+    if (size >= 8)
+        return (size + 7) & ~7ULL;
+
+    u64 stride = 1;
+    while (stride < size)
+        stride *= 2;
+    return stride;
+}
+
+static u64 align16(u64 value)
+{
+    return (value + 15) & ~15ULL;
+}
+
+// Returns a bit per slot in the group whose metadata byte equals value.
+static inline u32 group_match(const u8* group, u8 value)
+{
+#if HASHTABLE_SSE2
+    __m128i bytes = _mm_load_si128((const __m128i*)group);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)value)));
+#else
+    u32 mask = 0;
+    for (u32 i = 0; i < HASHTABLE_GROUP_WIDTH; ++i) {
+        if (group[i] == value)
+            mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+// Returns a bit per slot in the group that is empty or deleted.
+static inline u32 group_match_free(const u8* group)
+{
+#if HASHTABLE_SSE2
+    return (u32)_mm_movemask_epi8(_mm_load_si128((const __m128i*)group));
+#else
+    u32 mask = 0;
+    for (u32 i = 0; i < HASHTABLE_GROUP_WIDTH; ++i) {
+        if (group[i] & 0x80)
+            mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+static u64 key_hash(const hashtable* table, const void* key)
+{
+    if (table->key_size == HASHTABLE_KEY_STRING)
+        return table->hash(key, string_length(key));
+    return table->hash(key, table->key_size);
+}
+
+static void* slot_key(const hashtable* table, u64 slot)
+{
+    u8* key = table->keys + slot * table->key_stride;
+    return table->key_size == HASHTABLE_KEY_STRING ? (void*)*(char**)key : (void*)key;
+}
+
+static void* slot_value(const hashtable* table, u64 slot)
+{
+    return table->values + slot * table->value_stride;
+}
+
+static b8 key_equal(const hashtable* table, u64 slot, const void* key)
+{
+    if (table->key_size == HASHTABLE_KEY_STRING)
+        return strings_equal(slot_key(table, slot), key);
+    return memcmp(slot_key(table, slot), key, table->key_size) == 0;
+}
+
+static void key_free(hashtable* table, u64 slot)
+{
+    if (table->key_size == HASHTABLE_KEY_STRING) {
+        char* key = slot_key(table, slot);
+        kfree(key, string_length(key) + 1, MEMORY_TAG_STRING);
+    }
+}
+
+static u64 find_slot(const hashtable* table, const void* key, u64 hash)
+{
+    u8 tag = hash & 0x7F;
+    u64 group_mask = table->capacity / HASHTABLE_GROUP_WIDTH - 1;
+    u64 group = (hash >> 7) & group_mask;
+
+    // Triangular steps over a power of two group count visit every group, and at least an eighth
+    // of the slots are always empty, so this terminates.
+    for (u64 step = 1;; ++step) {
+        const u8* metadata = table->metadata + group * HASHTABLE_GROUP_WIDTH;
+        for (u32 matches = group_match(metadata, tag); matches; matches &= matches - 1) {
+            u64 slot = group * HASHTABLE_GROUP_WIDTH + __builtin_ctz(matches);
+            if (key_equal(table, slot, key))
+                return slot;
+        }
+
+        // A key is always placed in the first group with room, so an empty slot ends the search.
+        if (group_match(metadata, SLOT_EMPTY))
+            return SLOT_NOT_FOUND;
+
+        group = (group + step) & group_mask;
+    }
+}
+
+static u64 find_free_slot(const hashtable* table, u64 hash)
+{
+    u64 group_mask = table->capacity / HASHTABLE_GROUP_WIDTH - 1;
+    u64 group = (hash >> 7) & group_mask;
+
+    for (u64 step = 1;; ++step) {
+        u32 free = group_match_free(table->metadata + group * HASHTABLE_GROUP_WIDTH);
+        if (free)
+            return group * HASHTABLE_GROUP_WIDTH + __builtin_ctz(free);
+        group = (group + step) & group_mask;
+    }
+}
+
+static b8 storage_allocate(hashtable* table, u64 capacity)
+{
+    u64 keys_offset = align16(capacity);
+    u64 values_offset = align16(keys_offset + capacity * table->key_stride);
+    u64 size = values_offset + capacity * table->value_stride;
+
+    u8* memory = kallocate_aligned_uninitialized(size, 16, MEMORY_TAG_DICT);
+    if (!memory)
+        return FALSE;
+
+    kset_memory(memory, SLOT_EMPTY, capacity);
+
+    table->memory = memory;
+    table->memory_size = size;
+    table->capacity = capacity;
+    table->count = 0;
+    table->growth_left = max_load(capacity);
+    table->metadata = memory;
+    table->keys = memory + keys_offset;
+    table->values = memory + values_offset;
+    return TRUE;
+}
+
+// Moves every entry into fresh storage of the given capacity, dropping deleted slots on the way.
+static b8 rehash(hashtable* table, u64 capacity)
+{
+    hashtable old = *table;
+    if (!storage_allocate(table, capacity)) {
+        *table = old;
+        KERROR("hashtable - failed to grow to %llu slots.", capacity);
+        return FALSE;
+    }
+
+    for (u64 slot = 0; slot < old.capacity; ++slot) {
+        if (old.metadata[slot] & 0x80)
+            continue;
+
+        u64 hash = key_hash(&old, slot_key(&old, slot));
+        u64 target = find_free_slot(table, hash);
+        table->metadata[target] = hash & 0x7F;
+        // String keys are moved as pointers, not duplicated again.
+        kcopy_memory(table->keys + target * table->key_stride, old.keys + slot * old.key_stride, table->key_stride);
+        kcopy_memory(slot_value(table, target), slot_value(&old, slot), table->value_size);
+    }
+
+    table->count = old.count;
+    table->growth_left -= old.count;
+
+    kfree_aligned(old.memory, old.memory_size, 16, MEMORY_TAG_DICT);
+    return TRUE;
+}
+
+b8 hashtable_create(u64 key_size, u64 value_size, u64 capacity, b8 is_pointer_type, PFN_hashtable_hash hash, hashtable* out_table)
+{
+    if (!out_table) {
+        KERROR("hashtable_create requires a valid pointer to hold the table.");
+        return FALSE;
+    }
+
+    if (is_pointer_type)
+        value_size = sizeof(void*);
+
+    if (value_size == 0) {
+        KERROR("hashtable_create requires a non-zero value size.");
+        return FALSE;
+    }
+
+    kzero_memory(out_table, sizeof(hashtable));
+    out_table->key_size = key_size;
+    out_table->value_size = value_size;
+    out_table->key_stride = key_size == HASHTABLE_KEY_STRING ? sizeof(char*) : element_stride(key_size);
+    out_table->value_stride = element_stride(value_size);
+    out_table->is_pointer_type = is_pointer_type;
+    out_table->hash = hash ? hash : hashtable_hash_bytes;
+
+    return storage_allocate(out_table, capacity_for(capacity));
+}
+
+void hashtable_destroy(hashtable* table)
+{
+    if (!table || !table->memory)
+        return;
+
+    hashtable_clear(table);
+    kfree_aligned(table->memory, table->memory_size, 16, MEMORY_TAG_DICT);
+    kzero_memory(table, sizeof(hashtable));
+}
+
+b8 hashtable_set(hashtable* table, const void* key, const void* value)
+{
+    u64 hash = key_hash(table, key);
+    u64 slot = find_slot(table, key, hash);
+
+    if (slot == SLOT_NOT_FOUND) {
+        slot = find_free_slot(table, hash);
+
+        // Filling an empty slot uses up growth, reusing a deleted one does not.
+        if (table->metadata[slot] == SLOT_EMPTY && table->growth_left == 0) {
+            // Mostly deleted slots only need cleaning up, not more room.
+            u64 capacity = table->count + 1 > max_load(table->capacity) / 2 ? table->capacity * 2 : table->capacity;
+            if (!rehash(table, capacity))
+                return FALSE;
+            slot = find_free_slot(table, hash);
+        }
+
+        if (table->metadata[slot] == SLOT_EMPTY)
+            table->growth_left--;
+
+        table->metadata[slot] = hash & 0x7F;
+        u8* stored_key = table->keys + slot * table->key_stride;
+        if (table->key_size == HASHTABLE_KEY_STRING)
+            *(char**)stored_key = string_duplicate(key);
+        else
+            kcopy_memory(stored_key, key, table->key_size);
+        table->count++;
+    }
+
+    kcopy_memory(slot_value(table, slot), value, table->value_size);
+    return TRUE;
+}
+
+b8 hashtable_get(const hashtable* table, const void* key, void* out_value)
+{
+    void* value = hashtable_find(table, key);
+    if (!value)
+        return FALSE;
+
+    kcopy_memory(out_value, value, table->value_size);
+    return TRUE;
+}
+
+b8 hashtable_set_ptr(hashtable* table, const void* key, void* value)
+{
+    if (!table->is_pointer_type) {
+        KERROR("hashtable_set_ptr should not be used with tables that do not have pointer types.");
+        return FALSE;
+    }
+    return hashtable_set(table, key, &value);
+}
+
+b8 hashtable_get_ptr(const hashtable* table, const void* key, void** out_value)
+{
+    if (!table->is_pointer_type) {
+        KERROR("hashtable_get_ptr should not be used with tables that do not have pointer types.");
+        return FALSE;
+    }
+    return hashtable_get(table, key, out_value);
+}
+
+void* hashtable_find(const hashtable* table, const void* key)
+{
+    u64 slot = find_slot(table, key, key_hash(table, key));
+    return slot == SLOT_NOT_FOUND ? 0 : slot_value(table, slot);
+}
+
+b8 hashtable_remove(hashtable* table, const void* key)
+{
+    u64 slot = find_slot(table, key, key_hash(table, key));
+    if (slot == SLOT_NOT_FOUND)
+        return FALSE;
+
+    key_free(table, slot);
+
+    // If the group still has an empty slot, no search ever went past it, so this slot can become
+    // empty again. Otherwise it has to stay a marker for the searches that did.
+    const u8* group = table->metadata + (slot & ~(u64)(HASHTABLE_GROUP_WIDTH - 1));
+    if (group_match(group, SLOT_EMPTY)) {
+        table->metadata[slot] = SLOT_EMPTY;
+        table->growth_left++;
+    } else {
+        table->metadata[slot] = SLOT_DELETED;
+    }
+
+    table->count--;
+    return TRUE;
+}
+
+void hashtable_clear(hashtable* table)
+{
+    if (table->key_size == HASHTABLE_KEY_STRING) {
+        for (u64 slot = 0; slot < table->capacity; ++slot) {
+            if (!(table->metadata[slot] & 0x80))
+                key_free(table, slot);
+        }
+    }
+
+    kset_memory(table->metadata, SLOT_EMPTY, table->capacity);
+    table->count = 0;
+    table->growth_left = max_load(table->capacity);
+}
+
+b8 hashtable_reserve(hashtable* table, u64 count)
+{
+    if (count <= table->count + table->growth_left)
+        return TRUE;
+    return rehash(table, capacity_for(count));
+}
+
+b8 hashtable_next(const hashtable* table, u64* iterator, const void** out_key, void** out_value)
+{
+    for (u64 slot = *iterator; slot < table->capacity; ++slot) {
+        if (table->metadata[slot] & 0x80)
+            continue;
+
+        if (out_key)
+            *out_key = slot_key(table, slot);
+        if (out_value)
+            *out_value = slot_value(table, slot);
+        *iterator = slot + 1;
+        return TRUE;
+    }
+
+    *iterator = table->capacity;
+    return FALSE;
+}
+
+static u64 mix(u64 value)
+{
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDULL;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+u64 hashtable_hash_bytes(const void* key, u64 size)
+{
+    const u8* bytes = key;
+    u64 hash = 0x9E3779B97F4A7C15ULL ^ (size * 0xFF51AFD7ED558CCDULL);
+
+    while (size >= 8) {
+        u64 word;
+        memcpy(&word, bytes, 8);
+        hash = (hash ^ mix(word)) * 0x9E3779B97F4A7C15ULL;
+        bytes += 8;
+        size -= 8;
+    }
+
+    if (size) {
+        u64 word = 0;
+        memcpy(&word, bytes, size);
+        hash = (hash ^ mix(word)) * 0x9E3779B97F4A7C15ULL;
+    }
+
+    return mix(hash);
+}
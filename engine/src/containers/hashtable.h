@@ -0,0 +1,148 @@
+#pragma once
+
+#include "defines.h"
+
+/**
+ * Hashes a key. For string keys, size is the length of the string without the terminator.
+ * Only the top 57 bits pick the probe position and the low 7 bits are stored in the metadata, so
+ * every bit of the result should depend on every bit of the key.
+ */
+typedef u64 (*PFN_hashtable_hash)(const void* key, u64 size);
+
+// The number of slots scanned at once, one metadata byte each.
+#define HASHTABLE_GROUP_WIDTH 16
+
+// Pass as key_size for null-terminated string keys. The table keeps its own copy of each key.
+#define HASHTABLE_KEY_STRING 0
+
+/**
+ * An open addressing hash table. Each slot has a metadata byte holding either its state or 7 bits
+ * of its key's hash, and lookups compare a whole group of those bytes against the hash at once,
+ * so a key is usually found, or known to be missing, after touching a single group and one key.
+ * Keys and values are stored by copy in flat arrays. Not thread safe.
+ */
+typedef struct hashtable {
+    // The size of a key, or HASHTABLE_KEY_STRING.
+    u64 key_size;
+    u64 value_size;
+    u64 key_stride;
+    u64 value_stride;
+    // TRUE if values are pointers, stored by hashtable_set_ptr rather than copied.
+    b8 is_pointer_type;
+
+    // The number of slots. Always a power of two, and at least one group.
+    u64 capacity;
+    u64 count;
+    // The number of empty slots that may still be filled before the table has to grow.
+    u64 growth_left;
+
+    u8* metadata;
+    u8* keys;
+    u8* values;
+
+    PFN_hashtable_hash hash;
+
+    void* memory;
+    u64 memory_size;
+} hashtable;
+
+/**
+ * Creates a hash table.
+ * @param key_size The size of a key in bytes, or HASHTABLE_KEY_STRING for string keys.
+ * @param value_size The size of a value in bytes. Ignored if is_pointer_type is TRUE.
+ * @param capacity The number of entries to make room for up front. May be 0.
+ * @param is_pointer_type Indicates if values are pointers, which are stored as-is.
+ * @param hash The hash function to use, or 0/NULL for hashtable_hash_bytes.
+ * @param out_table A pointer to hold the created table.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 hashtable_create(u64 key_size, u64 value_size, u64 capacity, b8 is_pointer_type, PFN_hashtable_hash hash, hashtable* out_table);
+
+/**
+ * Destroys the table, along with its copies of any string keys.
+ * @param table A pointer to the table to be destroyed.
+ */
+KAPI void hashtable_destroy(hashtable* table);
+
+/**
+ * Copies a value into the table, replacing the value already stored for the key, if any.
+ * @param table A pointer to the table.
+ * @param key A pointer to the key, or the string itself for string keys.
+ * @param value A pointer to the value to be copied.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 hashtable_set(hashtable* table, const void* key, const void* value);
+
+/**
+ * Copies the value stored for a key.
+ * @param table A pointer to the table.
+ * @param key A pointer to the key, or the string itself for string keys.
+ * @param out_value A pointer to hold a copy of the value.
+ * @returns TRUE if the key was found; otherwise FALSE.
+ */
+KAPI b8 hashtable_get(const hashtable* table, const void* key, void* out_value);
+
+/**
+ * Stores a pointer in a table created with is_pointer_type.
+ * @param table A pointer to the table.
+ * @param key A pointer to the key, or the string itself for string keys.
+ * @param value The pointer to be stored.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 hashtable_set_ptr(hashtable* table, const void* key, void* value);
+
+/**
+ * Gets a pointer stored in a table created with is_pointer_type.
+ * @param table A pointer to the table.
+ * @param key A pointer to the key, or the string itself for string keys.
+ * @param out_value A pointer to hold the stored pointer.
+ * @returns TRUE if the key was found; otherwise FALSE.
+ */
+KAPI b8 hashtable_get_ptr(const hashtable* table, const void* key, void** out_value);
+
+/**
+ * Finds the value stored for a key without copying it.
+ * @param table A pointer to the table.
+ * @param key A pointer to the key, or the string itself for string keys.
+ * @returns A pointer to the value inside the table, or 0/NULL if the key is not present. Only
+ * valid until the table is next modified.
+ */
+KAPI void* hashtable_find(const hashtable* table, const void* key);
+
+/**
+ * Removes a key and its value.
+ * @param table A pointer to the table.
+ * @param key A pointer to the key, or the string itself for string keys.
+ * @returns TRUE if the key was found; otherwise FALSE.
+ */
+KAPI b8 hashtable_remove(hashtable* table, const void* key);
+
+/**
+ * Removes every entry, keeping the capacity.
+ * @param table A pointer to the table.
+ */
+KAPI void hashtable_clear(hashtable* table);
+
+/**
+ * Makes sure the table can hold at least count entries without growing again.
+ * @param table A pointer to the table.
+ * @param count The number of entries the table should fit.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 hashtable_reserve(hashtable* table, u64 count);
+
+/**
+ * Steps through the entries in no particular order. The table must not be modified in between.
+ * @param table A pointer to the table.
+ * @param iterator A pointer to the position, which must start out as 0.
+ * @param out_key A pointer to hold a pointer to the key, or the string itself for string keys. Optional.
+ * @param out_value A pointer to hold a pointer to the value. Optional.
+ * @returns TRUE if an entry was found; FALSE once every entry has been visited.
+ */
+KAPI b8 hashtable_next(const hashtable* table, u64* iterator, const void** out_key, void** out_value);
+
+// The default hash function. Fast on short keys and well mixed.
+KAPI u64 hashtable_hash_bytes(const void* key, u64 size);
+
+#define hashtable_count(table) \
+    ((table)->count)
@@ -0,0 +1,564 @@
+#include "ordered_map.h"
+
+#include "core/kmemory.h"
+#include "core/logger.h"
+
+// Sized so both node types take up exactly four cache lines, values aside.
+#define LEAF_KEYS 29
+#define INTERNAL_KEYS 15
+
+// Every node but the root stays at least half full.
+#define LEAF_MIN (LEAF_KEYS / 2)
+#define INTERNAL_MIN (INTERNAL_KEYS / 2)
+
+#define NODE_ALIGNMENT 64
+#define NODES_PER_PAGE 64
+
+// More than enough for 2^64 keys at the minimum fan-out.
+#define MAX_DEPTH 24
+
+typedef struct node_header {
+    u32 count;
+    b8 is_leaf;
+} node_header;
+
+// Has count keys and count + 1 children. Child i holds the keys in [keys[i - 1], keys[i]).
+typedef struct internal_node {
+    node_header header;
+    u64 keys[INTERNAL_KEYS];
+    void* children[INTERNAL_KEYS + 1];
+} internal_node;
+
+// The values follow the node, value_size bytes each.
+typedef struct leaf_node {
+    node_header header;
+    struct leaf_node* prev;
+    struct leaf_node* next;
+    u64 keys[LEAF_KEYS];
+} leaf_node;
+
+STATIC_ASSERT(sizeof(internal_node) == 4 * NODE_ALIGNMENT, "An internal node should fill four cache lines.");
+STATIC_ASSERT(sizeof(leaf_node) == 4 * NODE_ALIGNMENT, "A leaf node's keys should fill four cache lines.");
+
+typedef struct path_entry {
+    internal_node* node;
+    // The child that was descended into.
+    u32 index;
+} path_entry;
+
+static u8* leaf_value(const ordered_map* map, leaf_node* leaf, u32 index)
+{
+    return (u8*)(leaf + 1) + index * map->value_size;
+}
+
+// The scans below compare every key instead of stopping early. Nodes are small enough that this
+// beats a binary search, and it compiles to branch-free vector code.
+static u32 internal_child_index(const internal_node* node, u64 key)
+{
+    u32 index = 0;
+    for (u32 i = 0; i < node->header.count; ++i)
+        index += node->keys[i] <= key;
+    return index;
+}
+
+static u32 leaf_lower_bound(const leaf_node* leaf, u64 key)
+{
+    u32 index = 0;
+    for (u32 i = 0; i < leaf->header.count; ++i)
+        index += leaf->keys[i] < key;
+    return index;
+}
+
+static leaf_node* descend(const ordered_map* map, u64 key, path_entry* path, u32* out_depth)
+{
+    u32 depth = 0;
+    void* node = map->root;
+    while (!((node_header*)node)->is_leaf) {
+        internal_node* internal = node;
+        u32 index = internal_child_index(internal, key);
+        if (path) {
+            path[depth].node = internal;
+            path[depth].index = index;
+        }
+        depth++;
+        node = internal->children[index];
+    }
+
+    if (out_depth)
+        *out_depth = depth;
+    return node;
+}
+
+static leaf_node* leaf_create(ordered_map* map)
+{
+    leaf_node* leaf = pool_allocator_allocate(&map->leaf_pool);
+    if (leaf)
+        leaf->header.is_leaf = TRUE;
+    return leaf;
+}
+
+static void leaf_insert_at(ordered_map* map, leaf_node* leaf, u32 index, u64 key, const void* value)
+{
+    u32 after = leaf->header.count - index;
+    kmove_memory(&leaf->keys[index + 1], &leaf->keys[index], after * sizeof(u64));
+    kmove_memory(leaf_value(map, leaf, index + 1), leaf_value(map, leaf, index), after * map->value_size);
+    leaf->keys[index] = key;
+    kcopy_memory(leaf_value(map, leaf, index), value, map->value_size);
+    leaf->header.count++;
+}
+
+static void leaf_remove_at(ordered_map* map, leaf_node* leaf, u32 index)
+{
+    u32 after = leaf->header.count - index - 1;
+    kmove_memory(&leaf->keys[index], &leaf->keys[index + 1], after * sizeof(u64));
+    kmove_memory(leaf_value(map, leaf, index), leaf_value(map, leaf, index + 1), after * map->value_size);
+    leaf->header.count--;
+}
+
+// Moves count entries starting at from_index in source to the end of dest.
+static void leaf_move(ordered_map* map, leaf_node* dest, leaf_node* source, u32 from_index, u32 count)
+{
+    kcopy_memory(&dest->keys[dest->header.count], &source->keys[from_index], count * sizeof(u64));
+    kcopy_memory(leaf_value(map, dest, dest->header.count), leaf_value(map, source, from_index), count * map->value_size);
+    dest->header.count += count;
+    source->header.count -= count;
+}
+
+static void leaf_unlink(leaf_node* leaf)
+{
+    if (leaf->prev)
+        leaf->prev->next = leaf->next;
+    if (leaf->next)
+        leaf->next->prev = leaf->prev;
+}
+
+// Inserts key at index and child just right of it.
+static void internal_insert_at(internal_node* node, u32 index, u64 key, void* child)
+{
+    u32 after = node->header.count - index;
+    kmove_memory(&node->keys[index + 1], &node->keys[index], after * sizeof(u64));
+    kmove_memory(&node->children[index + 2], &node->children[index + 1], after * sizeof(void*));
+    node->keys[index] = key;
+    node->children[index + 1] = child;
+    node->header.count++;
+}
+
+// Removes the key at index and the child just right of it.
+static void internal_remove_at(internal_node* node, u32 index)
+{
+    u32 after = node->header.count - index - 1;
+    kmove_memory(&node->keys[index], &node->keys[index + 1], after * sizeof(u64));
+    kmove_memory(&node->children[index + 1], &node->children[index + 2], after * sizeof(void*));
+    node->header.count--;
+}
+
+b8 ordered_map_create(u64 value_size, ordered_map* out_map)
+{
+    if (!out_map || value_size == 0) {
+        KERROR("ordered_map_create requires a non-zero value size and a valid pointer to hold the map.");
+        return FALSE;
+    }
+
+    kzero_memory(out_map, sizeof(ordered_map));
+    out_map->value_size = value_size;
+
+    if (!pool_allocator_create(sizeof(leaf_node) + LEAF_KEYS * value_size, NODE_ALIGNMENT, NODES_PER_PAGE, MEMORY_TAG_BST, &out_map->leaf_pool)
+        || !pool_allocator_create(sizeof(internal_node), NODE_ALIGNMENT, NODES_PER_PAGE, MEMORY_TAG_BST, &out_map->internal_pool)) {
+        KERROR("ordered_map_create - failed to create the node pools.");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void ordered_map_destroy(ordered_map* map)
+{
+    if (!map)
+        return;
+
+    pool_allocator_destroy(&map->leaf_pool);
+    pool_allocator_destroy(&map->internal_pool);
+    kzero_memory(map, sizeof(ordered_map));
+}
+
+b8 ordered_map_insert(ordered_map* map, u64 key, const void* value)
+{
+    if (!map->root) {
+        map->root = leaf_create(map);
+        if (!map->root)
+            return FALSE;
+    }
+
+    path_entry path[MAX_DEPTH];
+    u32 depth;
+    leaf_node* leaf = descend(map, key, path, &depth);
+    u32 index = leaf_lower_bound(leaf, key);
+
+    if (index < leaf->header.count && leaf->keys[index] == key) {
+        kcopy_memory(leaf_value(map, leaf, index), value, map->value_size);
+        return TRUE;
+    }
+
+    if (leaf->header.count < LEAF_KEYS) {
+        leaf_insert_at(map, leaf, index, key, value);
+        map->count++;
+        return TRUE;
+    }
+
+    // The leaf has to split, along with every full node above it. Allocate all of the new nodes
+    // up front, so running out of memory cannot leave the tree half split.
+    u32 splits = 0;
+    while (splits < depth && path[depth - 1 - splits].node->header.count == INTERNAL_KEYS)
+        splits++;
+    u32 internal_count = splits + (splits == depth ? 1 : 0);
+
+    internal_node* spares[MAX_DEPTH + 1];
+    leaf_node* right = leaf_create(map);
+    u32 allocated = 0;
+    while (right && allocated < internal_count && (spares[allocated] = pool_allocator_allocate(&map->internal_pool)))
+        allocated++;
+
+    if (!right || allocated < internal_count) {
+        KERROR("ordered_map_insert - failed to allocate nodes.");
+        if (right)
+            pool_allocator_free(&map->leaf_pool, right);
+        while (allocated)
+            pool_allocator_free(&map->internal_pool, spares[--allocated]);
+        return FALSE;
+    }
+
+    // Split evenly once the new key is in. Whichever half it goes into starts out one short.
+    u32 half = (LEAF_KEYS + 1) / 2;
+    u32 left_count = index < half ? half - 1 : half;
+    leaf_move(map, right, leaf, left_count, LEAF_KEYS - left_count);
+    if (index < half)
+        leaf_insert_at(map, leaf, index, key, value);
+    else
+        leaf_insert_at(map, right, index - left_count, key, value);
+    map->count++;
+
+    right->next = leaf->next;
+    if (right->next)
+        right->next->prev = right;
+    right->prev = leaf;
+    leaf->next = right;
+
+    // Hand the separator and new node up until a node has room for them.
+    u64 separator = right->keys[0];
+    void* child = right;
+    for (i32 level = (i32)depth - 1; level >= 0; --level) {
+        internal_node* node = path[level].node;
+        u32 child_index = path[level].index;
+        if (node->header.count < INTERNAL_KEYS) {
+            internal_insert_at(node, child_index, separator, child);
+            return TRUE;
+        }
+
+        u64 keys[INTERNAL_KEYS + 1];
+        void* children[INTERNAL_KEYS + 2];
+        kcopy_memory(keys, node->keys, child_index * sizeof(u64));
+        keys[child_index] = separator;
+        kcopy_memory(&keys[child_index + 1], &node->keys[child_index], (INTERNAL_KEYS - child_index) * sizeof(u64));
+        kcopy_memory(children, node->children, (child_index + 1) * sizeof(void*));
+        children[child_index + 1] = child;
+        kcopy_memory(&children[child_index + 2], &node->children[child_index + 1], (INTERNAL_KEYS - child_index) * sizeof(void*));
+
+        // The middle key moves up rather than to either half.
+        u32 middle = (INTERNAL_KEYS + 1) / 2;
+        internal_node* sibling = spares[--allocated];
+        node->header.count = middle;
+        kcopy_memory(node->keys, keys, middle * sizeof(u64));
+        kcopy_memory(node->children, children, (middle + 1) * sizeof(void*));
+        sibling->header.count = INTERNAL_KEYS - middle;
+        kcopy_memory(sibling->keys, &keys[middle + 1], sibling->header.count * sizeof(u64));
+        kcopy_memory(sibling->children, &children[middle + 1], (sibling->header.count + 1) * sizeof(void*));
+
+        separator = keys[middle];
+        child = sibling;
+    }
+
+    // The root split as well, the tree grows a level.
+    internal_node* root = spares[--allocated];
+    root->header.count = 1;
+    root->keys[0] = separator;
+    root->children[0] = map->root;
+    root->children[1] = child;
+    map->root = root;
+    return TRUE;
+}
+
+void* ordered_map_find(const ordered_map* map, u64 key)
+{
+    if (!map->root)
+        return 0;
+
+    leaf_node* leaf = descend(map, key, 0, 0);
+    u32 index = leaf_lower_bound(leaf, key);
+    if (index < leaf->header.count && leaf->keys[index] == key)
+        return leaf_value(map, leaf, index);
+    return 0;
+}
+
+b8 ordered_map_get(const ordered_map* map, u64 key, void* out_value)
+{
+    void* value = ordered_map_find(map, key);
+    if (!value)
+        return FALSE;
+
+    kcopy_memory(out_value, value, map->value_size);
+    return TRUE;
+}
+
+// Refills an internal node that fell below the minimum, from a sibling or by merging with one.
+// Returns TRUE if its parent lost a child as a result.
+static b8 internal_rebalance(ordered_map* map, internal_node* node, internal_node* parent, u32 index)
+{
+    internal_node* left = index > 0 ? parent->children[index - 1] : 0;
+    internal_node* right = index < parent->header.count ? parent->children[index + 1] : 0;
+
+    if (left && left->header.count > INTERNAL_MIN) {
+        // Rotate right through the parent.
+        kmove_memory(&node->keys[1], node->keys, node->header.count * sizeof(u64));
+        kmove_memory(&node->children[1], node->children, (node->header.count + 1) * sizeof(void*));
+        node->keys[0] = parent->keys[index - 1];
+        node->children[0] = left->children[left->header.count];
+        node->header.count++;
+        parent->keys[index - 1] = left->keys[left->header.count - 1];
+        left->header.count--;
+        return FALSE;
+    }
+
+    if (right && right->header.count > INTERNAL_MIN) {
+        // Rotate left through the parent.
+        node->keys[node->header.count] = parent->keys[index];
+        node->children[node->header.count + 1] = right->children[0];
+        node->header.count++;
+        parent->keys[index] = right->keys[0];
+        kmove_memory(right->keys, &right->keys[1], (right->header.count - 1) * sizeof(u64));
+        kmove_memory(right->children, &right->children[1], right->header.count * sizeof(void*));
+        right->header.count--;
+        return FALSE;
+    }
+
+    // Merge the right one of the pair into the left one, pulling the separator down between them.
+    internal_node* into = left ? left : node;
+    internal_node* from = left ? node : right;
+    u32 separator_index = left ? index - 1 : index;
+
+    into->keys[into->header.count] = parent->keys[separator_index];
+    kcopy_memory(&into->keys[into->header.count + 1], from->keys, from->header.count * sizeof(u64));
+    kcopy_memory(&into->children[into->header.count + 1], from->children, (from->header.count + 1) * sizeof(void*));
+    into->header.count += 1 + from->header.count;
+
+    pool_allocator_free(&map->internal_pool, from);
+    internal_remove_at(parent, separator_index);
+    return TRUE;
+}
+
+b8 ordered_map_remove(ordered_map* map, u64 key)
+{
+    if (!map->root)
+        return FALSE;
+
+    path_entry path[MAX_DEPTH];
+    u32 depth;
+    leaf_node* leaf = descend(map, key, path, &depth);
+    u32 index = leaf_lower_bound(leaf, key);
+    if (index >= leaf->header.count || leaf->keys[index] != key)
+        return FALSE;
+
+    leaf_remove_at(map, leaf, index);
+    map->count--;
+
+    if (depth == 0) {
+        if (leaf->header.count == 0) {
+            pool_allocator_free(&map->leaf_pool, leaf);
+            map->root = 0;
+        }
+        return TRUE;
+    }
+
+    // Separators above may still name the removed key. That is fine, they only have to route.
+    if (leaf->header.count >= LEAF_MIN)
+        return TRUE;
+
+    internal_node* parent = path[depth - 1].node;
+    u32 child_index = path[depth - 1].index;
+    leaf_node* left = child_index > 0 ? parent->children[child_index - 1] : 0;
+    leaf_node* right = child_index < parent->header.count ? parent->children[child_index + 1] : 0;
+
+    if (left && left->header.count > LEAF_MIN) {
+        u32 last = left->header.count - 1;
+        leaf_insert_at(map, leaf, 0, left->keys[last], leaf_value(map, left, last));
+        left->header.count--;
+        parent->keys[child_index - 1] = leaf->keys[0];
+        return TRUE;
+    }
+
+    if (right && right->header.count > LEAF_MIN) {
+        leaf_insert_at(map, leaf, leaf->header.count, right->keys[0], leaf_value(map, right, 0));
+        leaf_remove_at(map, right, 0);
+        parent->keys[child_index] = right->keys[0];
+        return TRUE;
+    }
+
+    // Neither sibling can spare an entry, so merge with one of them.
+    leaf_node* into = left ? left : leaf;
+    leaf_node* from = left ? leaf : right;
+    leaf_move(map, into, from, 0, from->header.count);
+    leaf_unlink(from);
+    pool_allocator_free(&map->leaf_pool, from);
+    internal_remove_at(parent, left ? child_index - 1 : child_index);
+
+    // The parent lost a child. Walk up for as long as nodes keep underflowing.
+    for (i32 level = (i32)depth - 1; level > 0; --level) {
+        internal_node* node = path[level].node;
+        if (node->header.count >= INTERNAL_MIN)
+            return TRUE;
+        if (!internal_rebalance(map, node, path[level - 1].node, path[level - 1].index))
+            return TRUE;
+    }
+
+    // A root left with a single child hands over to it, the tree shrinks a level.
+    internal_node* root = map->root;
+    if (root->header.count == 0) {
+        map->root = root->children[0];
+        pool_allocator_free(&map->internal_pool, root);
+    }
+    return TRUE;
+}
+
+void ordered_map_clear(ordered_map* map)
+{
+    pool_allocator_free_all(&map->leaf_pool);
+    pool_allocator_free_all(&map->internal_pool);
+    map->root = 0;
+    map->count = 0;
+}
+
+b8 ordered_map_build(ordered_map* map, const u64* keys, const void* values, u64 count)
+{
+    if (map->count) {
+        KERROR("ordered_map_build requires an empty map.");
+        return FALSE;
+    }
+
+    for (u64 i = 1; i < count; ++i) {
+        if (keys[i - 1] >= keys[i]) {
+            KERROR("ordered_map_build - keys must be in strictly ascending order, key %llu is not.", i);
+            return FALSE;
+        }
+    }
+
+    if (count == 0)
+        return TRUE;
+
+    // The nodes of the level being built, along with the smallest key under each.
+    u64 node_count = (count + LEAF_KEYS - 1) / LEAF_KEYS;
+    void** nodes = kallocate_uninitialized(node_count * sizeof(void*), MEMORY_TAG_BST);
+    u64* mins = kallocate_uninitialized(node_count * sizeof(u64), MEMORY_TAG_BST);
+    u64 array_count = node_count;
+    b8 result = FALSE;
+
+    // Spread the entries evenly, so the last node does not end up below the minimum.
+    const u8* value_bytes = values;
+    leaf_node* previous = 0;
+    u64 offset = 0;
+    for (u64 i = 0; i < node_count; ++i) {
+        leaf_node* leaf = leaf_create(map);
+        if (!leaf)
+            goto cleanup;
+
+        u32 entries = (u32)(count / node_count + (i < count % node_count ? 1 : 0));
+        kcopy_memory(leaf->keys, &keys[offset], entries * sizeof(u64));
+        kcopy_memory(leaf_value(map, leaf, 0), value_bytes + offset * map->value_size, entries * map->value_size);
+        leaf->header.count = entries;
+        leaf->prev = previous;
+        if (previous)
+            previous->next = leaf;
+        previous = leaf;
+
+        nodes[i] = leaf;
+        mins[i] = keys[offset];
+        offset += entries;
+    }
+
+    // Build each level above from the one below, in place, until a single root is left.
+    while (node_count > 1) {
+        u64 parent_count = (node_count + INTERNAL_KEYS) / (INTERNAL_KEYS + 1);
+        u64 child = 0;
+        for (u64 i = 0; i < parent_count; ++i) {
+            internal_node* node = pool_allocator_allocate(&map->internal_pool);
+            if (!node)
+                goto cleanup;
+
+            u32 children = (u32)(node_count / parent_count + (i < node_count % parent_count ? 1 : 0));
+            u64 first = child;
+            for (u32 c = 0; c < children; ++c, ++child) {
+                node->children[c] = nodes[child];
+                if (c > 0)
+                    node->keys[c - 1] = mins[child];
+            }
+            node->header.count = children - 1;
+
+            nodes[i] = node;
+            mins[i] = mins[first];
+        }
+        node_count = parent_count;
+    }
+
+    map->root = nodes[0];
+    map->count = count;
+    result = TRUE;
+
+cleanup:
+    if (!result) {
+        KERROR("ordered_map_build - failed to allocate nodes.");
+        pool_allocator_free_all(&map->leaf_pool);
+        pool_allocator_free_all(&map->internal_pool);
+    }
+
+    kfree(nodes, array_count * sizeof(void*), MEMORY_TAG_BST);
+    kfree(mins, array_count * sizeof(u64), MEMORY_TAG_BST);
+    return result;
+}
+
+b8 ordered_map_lower_bound(const ordered_map* map, u64 key, ordered_map_iterator* out_iterator)
+{
+    out_iterator->map = map;
+    out_iterator->leaf = 0;
+    out_iterator->index = 0;
+    if (!map->root)
+        return FALSE;
+
+    leaf_node* leaf = descend(map, key, 0, 0);
+    u32 index = leaf_lower_bound(leaf, key);
+
+    // Everything in this leaf is smaller, the answer is the first key of the next one.
+    if (index == leaf->header.count) {
+        leaf = leaf->next;
+        index = 0;
+    }
+
+    out_iterator->leaf = leaf;
+    out_iterator->index = index;
+    return leaf != 0;
+}
+
+b8 ordered_map_next(ordered_map_iterator* iterator, u64* out_key, void** out_value)
+{
+    leaf_node* leaf = iterator->leaf;
+    if (!leaf)
+        return FALSE;
+
+    if (out_key)
+        *out_key = leaf->keys[iterator->index];
+    if (out_value)
+        *out_value = leaf_value(iterator->map, leaf, iterator->index);
+
+    if (++iterator->index == leaf->header.count) {
+        iterator->leaf = leaf->next;
+        iterator->index = 0;
+    }
+    return TRUE;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "defines.h"
+#include "core/pool_allocator.h"
+
+/**
+ * An ordered map from u64 keys to fixed-size values, built as a B+ tree. Nodes are four cache
+ * lines wide, with the keys packed together ahead of anything else, so a lookup costs a handful
+ * of cache misses even over millions of keys. Values live only in the leaves, which are linked
+ * in key order for range iteration. Not thread safe.
+ */
+typedef struct ordered_map {
+    u64 value_size;
+    u64 count;
+    // A leaf or internal node, or 0/NULL while the map is empty.
+    void* root;
+
+    pool_allocator leaf_pool;
+    pool_allocator internal_pool;
+} ordered_map;
+
+/**
+ * A position in the map. Invalidated by any insert or remove.
+ */
+typedef struct ordered_map_iterator {
+    const ordered_map* map;
+    void* leaf;
+    u32 index;
+} ordered_map_iterator;
+
+/**
+ * Creates an empty map. Nodes are allocated under MEMORY_TAG_BST.
+ * @param value_size The size of a value in bytes.
+ * @param out_map A pointer to hold the created map.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 ordered_map_create(u64 value_size, ordered_map* out_map);
+
+/**
+ * Destroys the map and every node in it.
+ * @param map A pointer to the map to be destroyed.
+ */
+KAPI void ordered_map_destroy(ordered_map* map);
+
+/**
+ * Copies a value into the map, replacing the value already stored for the key, if any.
+ * @param map A pointer to the map.
+ * @param key The key.
+ * @param value A pointer to the value to be copied.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 ordered_map_insert(ordered_map* map, u64 key, const void* value);
+
+/**
+ * Finds the value stored for a key without copying it.
+ * @param map A pointer to the map.
+ * @param key The key.
+ * @returns A pointer to the value inside the map, or 0/NULL if the key is not present. Only valid
+ * until the map is next modified.
+ */
+KAPI void* ordered_map_find(const ordered_map* map, u64 key);
+
+/**
+ * Copies the value stored for a key.
+ * @param map A pointer to the map.
+ * @param key The key.
+ * @param out_value A pointer to hold a copy of the value.
+ * @returns TRUE if the key was found; otherwise FALSE.
+ */
+KAPI b8 ordered_map_get(const ordered_map* map, u64 key, void* out_value);
+
+/**
+ * Removes a key and its value.
+ * @param map A pointer to the map.
+ * @param key The key.
+ * @returns TRUE if the key was found; otherwise FALSE.
+ */
+KAPI b8 ordered_map_remove(ordered_map* map, u64 key);
+
+/**
+ * Removes every entry. The node memory is kept for reuse. Takes time proportional to the number of
+ * nodes the map has allocated, not O(1), since their slots are threaded back onto the node pools.
+ * @param map A pointer to the map.
+ */
+KAPI void ordered_map_clear(ordered_map* map);
+
+/**
+ * Fills an empty map from sorted input in O(n), rather than inserting one key at a time. Uses as
+ * few leaves as will hold every entry and spreads the entries evenly between them, so every leaf
+ * is nearly full and none is left below the minimum. This suits data that is mostly read afterwards.
+ * @param map A pointer to the map, which must be empty.
+ * @param keys A pointer to count keys in strictly ascending order.
+ * @param values A pointer to count contiguous values, one per key.
+ * @param count The number of entries.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 ordered_map_build(ordered_map* map, const u64* keys, const void* values, u64 count);
+
+/**
+ * Positions an iterator at the first key not less than the given one.
+ * @param map A pointer to the map.
+ * @param key The key to search for.
+ * @param out_iterator A pointer to hold the iterator.
+ * @returns TRUE if there is such a key; otherwise FALSE.
+ */
+KAPI b8 ordered_map_lower_bound(const ordered_map* map, u64 key, ordered_map_iterator* out_iterator);
+
+/**
+ * Gets the entry at the iterator's position and moves it on to the next key. To visit a range:
+ * position with ordered_map_lower_bound, then call this until it returns FALSE or the key is past
+ * the end of the range.
+ * @param iterator A pointer to the iterator.
+ * @param out_key A pointer to hold the key. Optional.
+ * @param out_value A pointer to hold a pointer to the value. Optional.
+ * @returns TRUE if there was an entry; FALSE once the end of the map has been reached.
+ */
+KAPI b8 ordered_map_next(ordered_map_iterator* iterator, u64* out_key, void** out_value);
+
+#define ordered_map_begin(map, out_iterator) \
+    ordered_map_lower_bound(map, 0, out_iterator)
+
+#define ordered_map_count(map) \
+    ((map)->count)
@@ -0,0 +1,266 @@
+#include "ring_queue.h"
+
+#include "core/kmemory.h"
+#include "core/logger.h"
+
+#define RING_QUEUE_CACHE_LINE 64
+
+STATIC_ASSERT(sizeof(ring_queue_cursor) == RING_QUEUE_CACHE_LINE, "A ring queue cursor must fill exactly one cache line.");
+
+// Every MPMC slot starts with a sequence number, which tells whose turn it is:
+//  - position: empty, and may be written by the producer that claims position.
+//  - position + 1: full, and may be read by the consumer that claims position.
+//  - position + capacity: read, and may be written again on the next lap around.
+typedef u64 ring_queue_sequence;
+
+static u64 mpmc_element_offset()
+{
+    return sizeof(ring_queue_sequence);
+}
+
+static ring_queue_cursor* producer(const ring_queue* queue)
+{
+    return &queue->cursors[0];
+}
+
+static ring_queue_cursor* consumer(const ring_queue* queue)
+{
+    return &queue->cursors[1];
+}
+
+static u8* slot_at(const ring_queue* queue, u64 position)
+{
+    return queue->slots + (position & queue->mask) * queue->stride;
+}
+
+// Copies count elements into the ring starting at position, wrapping around the end once if needed.
+static void ring_write(ring_queue* queue, u64 position, const u8* values, u64 count)
+{
+    u64 index = position & queue->mask;
+    u64 first = queue->capacity - index < count ? queue->capacity - index : count;
+    kcopy_memory(queue->slots + index * queue->stride, values, first * queue->element_size);
+    if (count > first)
+        kcopy_memory(queue->slots, values + first * queue->element_size, (count - first) * queue->element_size);
+}
+
+static void ring_read(const ring_queue* queue, u64 position, u8* out_values, u64 count)
+{
+    u64 index = position & queue->mask;
+    u64 first = queue->capacity - index < count ? queue->capacity - index : count;
+    kcopy_memory(out_values, queue->slots + index * queue->stride, first * queue->element_size);
+    if (count > first)
+        kcopy_memory(out_values + first * queue->element_size, queue->slots, (count - first) * queue->element_size);
+}
+
+b8 ring_queue_create(u64 element_size, u64 capacity, ring_queue_mode mode, ring_queue* out_queue)
+{
+    if (!out_queue || element_size == 0 || capacity == 0) {
+        KERROR("ring_queue_create requires a non-zero element size and capacity.");
+        return FALSE;
+    }
+
+    u64 rounded = 1;
+    while (rounded < capacity)
+        rounded *= 2;
+
+    kzero_memory(out_queue, sizeof(ring_queue));
+    out_queue->mode = mode;
+    out_queue->element_size = element_size;
+    out_queue->stride = mode == RING_QUEUE_MODE_MPMC
+                            ? (mpmc_element_offset() + element_size + 7) & ~7ULL
+                            : element_size;
+    out_queue->capacity = rounded;
+    out_queue->mask = rounded - 1;
+
+    // The cursors get a cache line each, and the slots start on the line after them.
+    out_queue->memory_size = 2 * sizeof(ring_queue_cursor) + out_queue->stride * rounded;
+    out_queue->memory = kallocate_aligned(out_queue->memory_size, RING_QUEUE_CACHE_LINE, MEMORY_TAG_RING_QUEUE);
+    if (!out_queue->memory) {
+        KERROR("ring_queue_create - failed to allocate %llu bytes.", out_queue->memory_size);
+        return FALSE;
+    }
+
+    out_queue->cursors = out_queue->memory;
+    out_queue->slots = (u8*)out_queue->memory + 2 * sizeof(ring_queue_cursor);
+
+    if (mode == RING_QUEUE_MODE_MPMC) {
+        for (u64 i = 0; i < rounded; ++i)
+            *(ring_queue_sequence*)slot_at(out_queue, i) = i;
+    }
+
+    return TRUE;
+}
+
+void ring_queue_destroy(ring_queue* queue)
+{
+    if (queue && queue->memory) {
+        kfree_aligned(queue->memory, queue->memory_size, RING_QUEUE_CACHE_LINE, MEMORY_TAG_RING_QUEUE);
+        kzero_memory(queue, sizeof(ring_queue));
+    }
+}
+
+// Claims the position at the back. Returns FALSE if the queue is full.
+static b8 mpmc_enqueue(ring_queue* queue, const void* value)
+{
+    u64* tail = &producer(queue)->position;
+    u64 position = __atomic_load_n(tail, __ATOMIC_RELAXED);
+
+    for (;;) {
+        u8* slot = slot_at(queue, position);
+        u64 sequence = __atomic_load_n((ring_queue_sequence*)slot, __ATOMIC_ACQUIRE);
+        i64 difference = (i64)(sequence - position);
+
+        if (difference == 0) {
+            if (__atomic_compare_exchange_n(tail, &position, position + 1, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                kcopy_memory(slot + mpmc_element_offset(), value, queue->element_size);
+                __atomic_store_n((ring_queue_sequence*)slot, position + 1, __ATOMIC_RELEASE);
+                return TRUE;
+            }
+            // The failed exchange has loaded the current tail, try again from there.
+        } else if (difference < 0) {
+            // Not yet read since the last lap.
+            return FALSE;
+        } else {
+            // Another producer got there first.
+            position = __atomic_load_n(tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static b8 mpmc_dequeue(ring_queue* queue, void* out_value)
+{
+    u64* head = &consumer(queue)->position;
+    u64 position = __atomic_load_n(head, __ATOMIC_RELAXED);
+
+    for (;;) {
+        u8* slot = slot_at(queue, position);
+        u64 sequence = __atomic_load_n((ring_queue_sequence*)slot, __ATOMIC_ACQUIRE);
+        i64 difference = (i64)(sequence - (position + 1));
+
+        if (difference == 0) {
+            if (__atomic_compare_exchange_n(head, &position, position + 1, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                kcopy_memory(out_value, slot + mpmc_element_offset(), queue->element_size);
+                __atomic_store_n((ring_queue_sequence*)slot, position + queue->capacity, __ATOMIC_RELEASE);
+                return TRUE;
+            }
+        } else if (difference < 0) {
+            // Not yet written.
+            return FALSE;
+        } else {
+            position = __atomic_load_n(head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// Returns how many of count elements can be enqueued, refreshing the cached head only when needed.
+static u64 spsc_enqueue_room(ring_queue* queue, u64 tail, u64 count)
+{
+    ring_queue_cursor* cursor = producer(queue);
+    u64 room = queue->capacity - (tail - cursor->cached);
+    if (room < count) {
+        cursor->cached = __atomic_load_n(&consumer(queue)->position, __ATOMIC_ACQUIRE);
+        room = queue->capacity - (tail - cursor->cached);
+    }
+    return room < count ? room : count;
+}
+
+static u64 spsc_dequeue_available(ring_queue* queue, u64 head, u64 count)
+{
+    ring_queue_cursor* cursor = consumer(queue);
+    u64 available = cursor->cached - head;
+    if (available < count) {
+        cursor->cached = __atomic_load_n(&producer(queue)->position, __ATOMIC_ACQUIRE);
+        available = cursor->cached - head;
+    }
+    return available < count ? available : count;
+}
+
+u64 ring_queue_enqueue_n(ring_queue* queue, const void* values, u64 count)
+{
+    ring_queue_cursor* cursor = producer(queue);
+
+    switch (queue->mode) {
+        case RING_QUEUE_MODE_SINGLE_THREADED: {
+            u64 room = queue->capacity - (cursor->position - consumer(queue)->position);
+            if (count > room)
+                count = room;
+            ring_write(queue, cursor->position, values, count);
+            cursor->position += count;
+            return count;
+        }
+        case RING_QUEUE_MODE_SPSC: {
+            u64 tail = cursor->position;
+            count = spsc_enqueue_room(queue, tail, count);
+            ring_write(queue, tail, values, count);
+            __atomic_store_n(&cursor->position, tail + count, __ATOMIC_RELEASE);
+            return count;
+        }
+        case RING_QUEUE_MODE_MPMC: {
+            const u8* bytes = values;
+            for (u64 i = 0; i < count; ++i) {
+                if (!mpmc_enqueue(queue, bytes + i * queue->element_size))
+                    return i;
+            }
+            return count;
+        }
+    }
+
+    return 0;
+}
+
+u64 ring_queue_dequeue_n(ring_queue* queue, void* out_values, u64 count)
+{
+    ring_queue_cursor* cursor = consumer(queue);
+
+    switch (queue->mode) {
+        case RING_QUEUE_MODE_SINGLE_THREADED: {
+            u64 available = producer(queue)->position - cursor->position;
+            if (count > available)
+                count = available;
+            ring_read(queue, cursor->position, out_values, count);
+            cursor->position += count;
+            return count;
+        }
+        case RING_QUEUE_MODE_SPSC: {
+            u64 head = cursor->position;
+            count = spsc_dequeue_available(queue, head, count);
+            ring_read(queue, head, out_values, count);
+            __atomic_store_n(&cursor->position, head + count, __ATOMIC_RELEASE);
+            return count;
+        }
+        case RING_QUEUE_MODE_MPMC: {
+            u8* bytes = out_values;
+            for (u64 i = 0; i < count; ++i) {
+                if (!mpmc_dequeue(queue, bytes + i * queue->element_size))
+                    return i;
+            }
+            return count;
+        }
+    }
+
+    return 0;
+}
+
+b8 ring_queue_enqueue(ring_queue* queue, const void* value)
+{
+    if (queue->mode == RING_QUEUE_MODE_MPMC)
+        return mpmc_enqueue(queue, value);
+    return ring_queue_enqueue_n(queue, value, 1) == 1;
+}
+
+b8 ring_queue_dequeue(ring_queue* queue, void* out_value)
+{
+    if (queue->mode == RING_QUEUE_MODE_MPMC)
+        return mpmc_dequeue(queue, out_value);
+    return ring_queue_dequeue_n(queue, out_value, 1) == 1;
+}
+
+u64 ring_queue_length(const ring_queue* queue)
+{
+    // Reading the head first means the tail can only be ahead of it, never behind. Producers moving
+    // on in between can still push the difference past the capacity.
+    u64 head = __atomic_load_n(&consumer(queue)->position, __ATOMIC_ACQUIRE);
+    u64 tail = __atomic_load_n(&producer(queue)->position, __ATOMIC_ACQUIRE);
+    u64 length = tail - head;
+    return length > queue->capacity ? queue->capacity : length;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "defines.h"
+
+typedef enum ring_queue_mode {
+    // No synchronization at all, for queues that never leave one thread.
+    RING_QUEUE_MODE_SINGLE_THREADED,
+    // Lock-free, for exactly one producer thread and one consumer thread.
+    RING_QUEUE_MODE_SPSC,
+    // Lock-free, for any number of producer and consumer threads.
+    RING_QUEUE_MODE_MPMC
+} ring_queue_mode;
+
+// Lives on a cache line of its own, so producers and consumers never write to the same one.
+typedef struct ring_queue_cursor {
+    // The next position to be written, or read.
+    u64 position;
+    // The other side's position as last seen. Only used by SPSC queues, to avoid touching the
+    // other side's cache line until the queue looks full, or empty.
+    u64 cached;
+    u8 padding[48];
+} ring_queue_cursor;
+
+/**
+ * A fixed-capacity FIFO queue of fixed-size elements. Elements are copied in and out. Enqueueing
+ * into a full queue or dequeueing from an empty one fails rather than waiting.
+ */
+typedef struct ring_queue {
+    ring_queue_mode mode;
+    u64 element_size;
+    // The size of each slot. MPMC slots carry a sequence number in front of the element.
+    u64 stride;
+    // Always a power of two.
+    u64 capacity;
+    u64 mask;
+
+    // The producer's cursor, followed by the consumer's.
+    ring_queue_cursor* cursors;
+    u8* slots;
+
+    void* memory;
+    u64 memory_size;
+} ring_queue;
+
+/**
+ * Creates a ring queue.
+ * @param element_size The size of an element in bytes.
+ * @param capacity The number of elements the queue can hold. Rounded up to a power of two.
+ * @param mode The kind of access the queue must support.
+ * @param out_queue A pointer to hold the created queue.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 ring_queue_create(u64 element_size, u64 capacity, ring_queue_mode mode, ring_queue* out_queue);
+
+/**
+ * Destroys the queue. No other thread may be using it.
+ * @param queue A pointer to the queue to be destroyed.
+ */
+KAPI void ring_queue_destroy(ring_queue* queue);
+
+/**
+ * Copies an element onto the back of the queue.
+ * @param queue A pointer to the queue.
+ * @param value A pointer to the element.
+ * @returns TRUE on success; FALSE if the queue is full.
+ */
+KAPI b8 ring_queue_enqueue(ring_queue* queue, const void* value);
+
+/**
+ * Copies the element at the front of the queue out and removes it.
+ * @param queue A pointer to the queue.
+ * @param out_value A pointer to hold the element.
+ * @returns TRUE on success; FALSE if the queue is empty.
+ */
+KAPI b8 ring_queue_dequeue(ring_queue* queue, void* out_value);
+
+/**
+ * Enqueues as many of the given elements as fit. Single-threaded and SPSC queues publish the whole
+ * batch at once; MPMC queues enqueue the elements one at a time, so other producers may interleave.
+ * @param queue A pointer to the queue.
+ * @param values A pointer to count contiguous elements.
+ * @param count The number of elements.
+ * @returns The number of elements enqueued, from the front of values.
+ */
+KAPI u64 ring_queue_enqueue_n(ring_queue* queue, const void* values, u64 count);
+
+/**
+ * Dequeues up to count elements. Single-threaded and SPSC queues release the whole batch at once;
+ * MPMC queues dequeue the elements one at a time.
+ * @param queue A pointer to the queue.
+ * @param out_values A pointer to room for count contiguous elements.
+ * @param count The largest number of elements to dequeue.
+ * @returns The number of elements dequeued.
+ */
+KAPI u64 ring_queue_dequeue_n(ring_queue* queue, void* out_values, u64 count);
+
+/**
+ * Gets the number of elements in the queue. Only a snapshot while other threads are using it.
+ * @param queue A pointer to the queue.
+ * @returns The number of elements.
+ */
+KAPI u64 ring_queue_length(const ring_queue* queue);
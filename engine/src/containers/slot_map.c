@@ -0,0 +1,145 @@
+#include "slot_map.h"
+
+#include "core/kmemory.h"
+#include "core/logger.h"
+
+#define INDEX_MASK (SLOT_MAP_MAX_CAPACITY - 1)
+#define GENERATION_MASK ((1u << SLOT_MAP_GENERATION_BITS) - 1)
+
+#define NO_SLOT 0xFFFFFFFFu
+
+// New slots are appended until this many are free, so a removed handle's slot is not reused
+// straight away and its generation wraps around far less often.
+#define MIN_FREE_SLOTS 64
+
+static slot_map_handle handle_make(u32 index, u32 generation)
+{
+    return (generation << SLOT_MAP_INDEX_BITS) | index;
+}
+
+// Returns the slot the handle refers to, or 0/NULL if the handle is stale or invalid.
+static slot_map_slot* slot_resolve(const slot_map* map, slot_map_handle handle)
+{
+    u32 index = handle & INDEX_MASK;
+    if (handle == SLOT_MAP_INVALID_HANDLE || index >= darray_length(map->slots))
+        return 0;
+
+    slot_map_slot* slot = &map->slots[index];
+    return slot->generation == handle >> SLOT_MAP_INDEX_BITS ? slot : 0;
+}
+
+static void slot_release(slot_map* map, u32 index)
+{
+    slot_map_slot* slot = &map->slots[index];
+
+    // Generation 0 is skipped, so no handle is ever 0.
+    slot->generation = (slot->generation + 1) & GENERATION_MASK;
+    if (slot->generation == 0)
+        slot->generation = 1;
+
+    slot->value_index = NO_SLOT;
+    if (map->free_count)
+        map->slots[map->free_tail].value_index = index;
+    else
+        map->free_head = index;
+    map->free_tail = index;
+    map->free_count++;
+}
+
+b8 slot_map_create(u64 value_size, u32 capacity, slot_map* out_map)
+{
+    if (!out_map || value_size == 0) {
+        KERROR("slot_map_create requires a non-zero value size and a valid pointer to hold the map.");
+        return FALSE;
+    }
+
+    if (capacity == 0)
+        capacity = DARRAY_DEFAULT_CAPACITY;
+
+    kzero_memory(out_map, sizeof(slot_map));
+    out_map->value_size = value_size;
+    out_map->slots = darray_reserve(slot_map_slot, capacity);
+    out_map->values = _darray_create(capacity, value_size);
+    out_map->value_slots = darray_reserve(u32, capacity);
+    out_map->free_head = NO_SLOT;
+    out_map->free_tail = NO_SLOT;
+    return TRUE;
+}
+
+void slot_map_destroy(slot_map* map)
+{
+    if (!map || !map->slots)
+        return;
+
+    darray_destroy(map->slots);
+    darray_destroy(map->values);
+    darray_destroy(map->value_slots);
+    kzero_memory(map, sizeof(slot_map));
+}
+
+slot_map_handle slot_map_insert(slot_map* map, const void* value)
+{
+    u32 slot_count = (u32)darray_length(map->slots);
+    u32 index;
+
+    if (map->free_count && (map->free_count >= MIN_FREE_SLOTS || slot_count == SLOT_MAP_MAX_CAPACITY)) {
+        index = map->free_head;
+        map->free_head = map->slots[index].value_index;
+        map->free_count--;
+    } else if (slot_count < SLOT_MAP_MAX_CAPACITY) {
+        index = slot_count;
+        slot_map_slot slot = {NO_SLOT, 1};
+        darray_push(map->slots, slot);
+    } else {
+        KERROR("slot_map_insert - the map is full at %u values.", SLOT_MAP_MAX_CAPACITY);
+        return SLOT_MAP_INVALID_HANDLE;
+    }
+
+    slot_map_slot* slot = &map->slots[index];
+    slot->value_index = slot_map_count(map);
+    map->values = _darray_push(map->values, value);
+    darray_push(map->value_slots, index);
+
+    return handle_make(index, slot->generation);
+}
+
+b8 slot_map_remove(slot_map* map, slot_map_handle handle)
+{
+    slot_map_slot* slot = slot_resolve(map, handle);
+    if (!slot)
+        return FALSE;
+
+    // The last value moves into the gap, so its slot has to follow it.
+    u32 value_index = slot->value_index;
+    u32 last = slot_map_count(map) - 1;
+    if (value_index != last)
+        map->slots[map->value_slots[last]].value_index = value_index;
+
+    darray_swap_remove(map->values, value_index, 0);
+    darray_swap_remove(map->value_slots, value_index, 0);
+
+    slot_release(map, handle & INDEX_MASK);
+    return TRUE;
+}
+
+void* slot_map_get(const slot_map* map, slot_map_handle handle)
+{
+    slot_map_slot* slot = slot_resolve(map, handle);
+    return slot ? (u8*)map->values + (u64)slot->value_index * map->value_size : 0;
+}
+
+slot_map_handle slot_map_handle_at(const slot_map* map, u32 index)
+{
+    u32 slot_index = map->value_slots[index];
+    return handle_make(slot_index, map->slots[slot_index].generation);
+}
+
+void slot_map_clear(slot_map* map)
+{
+    u32 count = slot_map_count(map);
+    for (u32 i = 0; i < count; ++i)
+        slot_release(map, map->value_slots[i]);
+
+    darray_clear(map->values);
+    darray_clear(map->value_slots);
+}
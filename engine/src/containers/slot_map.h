@@ -0,0 +1,113 @@
+#pragma once
+
+#include "defines.h"
+#include "containers/darray.h"
+
+/**
+ * A stable reference to a value in a slot map. The low bits pick a slot and the high bits hold
+ * the slot's generation, which changes whenever the value in it is removed, so handles to removed
+ * values are detected rather than silently resolving to whatever took their place.
+ */
+typedef u32 slot_map_handle;
+
+// Never handed out, so zero-initialized handles are always invalid.
+#define SLOT_MAP_INVALID_HANDLE 0
+
+#define SLOT_MAP_INDEX_BITS 20
+#define SLOT_MAP_GENERATION_BITS 12
+
+// The most values a slot map can hold at once.
+#define SLOT_MAP_MAX_CAPACITY (1u << SLOT_MAP_INDEX_BITS)
+
+typedef struct slot_map_slot {
+    // The index of the value in the dense array, or the next free slot while free.
+    u32 value_index;
+    u32 generation;
+} slot_map_slot;
+
+/**
+ * Stores fixed-size values packed together in a dense darray, for fast iteration, and hands out
+ * handles to them that stay valid as values move around. Insert, remove and lookup are all O(1).
+ * Removal moves the last value into the gap, so the order of the values is not kept. Not thread
+ * safe.
+ */
+typedef struct slot_map {
+    u64 value_size;
+
+    // darray of slots, indexed by the index part of a handle.
+    slot_map_slot* slots;
+    // darray of the values themselves.
+    void* values;
+    // darray of the slot each value belongs to, parallel to values.
+    u32* value_slots;
+
+    // Freed slots are reused oldest first, to spread generation increments across them.
+    u32 free_head;
+    u32 free_tail;
+    u32 free_count;
+} slot_map;
+
+/**
+ * Creates a slot map.
+ * @param value_size The size of a value in bytes.
+ * @param capacity The number of values to make room for up front.
+ * @param out_map A pointer to hold the created map.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 slot_map_create(u64 value_size, u32 capacity, slot_map* out_map);
+
+/**
+ * Destroys the slot map. Every handle into it becomes invalid.
+ * @param map A pointer to the map to be destroyed.
+ */
+KAPI void slot_map_destroy(slot_map* map);
+
+/**
+ * Copies a value into the map.
+ * @param map A pointer to the map.
+ * @param value A pointer to the value to be copied.
+ * @returns A handle to the value, or SLOT_MAP_INVALID_HANDLE if the map is full.
+ */
+KAPI slot_map_handle slot_map_insert(slot_map* map, const void* value);
+
+/**
+ * Removes a value.
+ * @param map A pointer to the map.
+ * @param handle The handle of the value.
+ * @returns TRUE if the handle was valid; otherwise FALSE.
+ */
+KAPI b8 slot_map_remove(slot_map* map, slot_map_handle handle);
+
+/**
+ * Gets a value by handle.
+ * @param map A pointer to the map.
+ * @param handle The handle of the value.
+ * @returns A pointer to the value, or 0/NULL if the handle is invalid or the value was removed.
+ * Only valid until the next insert or remove, which may move values.
+ */
+KAPI void* slot_map_get(const slot_map* map, slot_map_handle handle);
+
+/**
+ * Gets the handle of the value at an index of the dense array, e.g. while iterating.
+ * @param map A pointer to the map.
+ * @param index The index of the value, less than slot_map_count.
+ * @returns The value's handle.
+ */
+KAPI slot_map_handle slot_map_handle_at(const slot_map* map, u32 index);
+
+/**
+ * Removes every value. Every handle into the map becomes invalid.
+ * @param map A pointer to the map.
+ */
+KAPI void slot_map_clear(slot_map* map);
+
+#define slot_map_contains(map, handle) \
+    (slot_map_get(map, handle) != 0)
+
+// The number of values, which are packed at the start of slot_map_values.
+#define slot_map_count(map) \
+    ((u32)darray_length((map)->values))
+
+// The values, as a plain array for iteration.
+#define slot_map_values(map) \
+    ((map)->values)
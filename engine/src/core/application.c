@@ -7,6 +7,8 @@
 #include "core/event.h"
 #include "core/input.h"
 #include "core/kmemory.h"
+#include "core/kname.h"
+#include "core/linear_allocator.h"
 #include "platform/platform.h"
 
 #include "renderer/renderer_frontend.h"
@@ -23,8 +25,14 @@ typedef struct application_state {
 
     clock clock;
     f64 last_time;
+
+    // Scratch memory for data that only lives for a single frame. Reset after every frame is drawn.
+    linear_allocator frame_allocator;
 } application_state;
 
+// The frame allocator size used when the application config leaves it at 0.
+#define APPLICATION_DEFAULT_FRAME_ALLOCATOR_SIZE MEBIBYTES(64)
+
 static application_state app_state;
 static b8 initialized = FALSE;
 
@@ -57,6 +65,19 @@ b8 application_create(game* game_inst)
     app_state.is_running = TRUE;
     app_state.is_suspended = FALSE;
 
+    u64 frame_allocator_size = game_inst->app_config.frame_allocator_size;
+    if (frame_allocator_size == 0)
+        frame_allocator_size = APPLICATION_DEFAULT_FRAME_ALLOCATOR_SIZE;
+    if (!linear_allocator_create_virtual(frame_allocator_size, FALSE, &app_state.frame_allocator)) {
+        KFATAL("Failed to create the frame allocator. Application cannot continue.");
+        return FALSE;
+    }
+
+    if (!kname_initialize()) {
+        KERROR("Name system failed initialization. Application cannot continue.");
+        return FALSE;
+    }
+
     if (!event_initialize()) {
         KERROR("Event system failed initialization. Application cannot continue.");
         return FALSE;
@@ -111,7 +132,11 @@ b8 application_run()
     f64 frame_count = 0;
     f64 target_frame_seconds = 1.0f / 60;
 
-    KINFO(get_memory_usage_str());
+    memory_snapshot snapshot;
+    kmemory_get_snapshot(&snapshot);
+    char memory_report[4096];
+    kmemory_report_write(&snapshot, memory_report, sizeof(memory_report));
+    KINFO("%s", memory_report);
 
     while (app_state.is_running) {
         if (!platform_pump_messages(&app_state.platform))
@@ -143,6 +168,9 @@ b8 application_run()
             render_packet packet = { .delta_time = delta_time };
             renderer_draw_frame(&packet);
 
+            // Everything allocated for this frame is now dead, reclaim it in one go.
+            linear_allocator_free_all(&app_state.frame_allocator);
+
             // Figure out how long the frame took
             f64 frame_end_time = platform_get_absolute_time();
             f64 frame_elapsed_time = frame_end_time - frame_start_time;
@@ -168,6 +196,8 @@ b8 application_run()
             // this frame ends
             input_update(delta_time);
 
+            kmemory_frame_end();
+
             // Update last time
             app_state.last_time = current_time;
         }
@@ -182,9 +212,17 @@ b8 application_run()
 
     platform_shutdown(&app_state.platform);
 
+    kname_shutdown();
+    linear_allocator_destroy(&app_state.frame_allocator);
+
     return TRUE;
 }
 
+void* application_frame_allocate(u64 size)
+{
+    return linear_allocator_allocate(&app_state.frame_allocator, size);
+}
+
 b8 application_on_event(u16 code, void* sender, void* listener_inst, event_context context)
 {
     switch (code) {
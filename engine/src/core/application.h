@@ -18,8 +18,20 @@ typedef struct application_config {
 
     // The application name used in windowing, if applicable
     char* name;
+
+    // The most scratch memory a single frame may use, or 0 for the default. Only what is actually used gets committed.
+    u64 frame_allocator_size;
 } application_config;
 
 KAPI b8 application_create(struct game* game_inst);
 
 KAPI b8 application_run();
+
+/**
+ * Allocates scratch memory that is valid until the end of the current frame. The memory is
+ * reclaimed all at once after the frame is drawn, so it must never be freed manually nor
+ * referenced in a later frame. The memory is NOT zeroed.
+ * @param size The size in bytes to be allocated.
+ * @returns A pointer to the allocated block, or 0/NULL if the frame allocator is exhausted.
+ */
+KAPI void* application_frame_allocate(u64 size);
@@ -0,0 +1,223 @@
+#include "dynamic_allocator.h"
+
+#include "core/logger.h"
+
+// A free region. Lives at the start of the region it describes.
+typedef struct dynamic_allocator_block {
+    u64 size;
+    struct dynamic_allocator_block* next;
+} dynamic_allocator_block;
+
+STATIC_ASSERT(sizeof(dynamic_allocator_block) <= DYNAMIC_ALLOCATOR_ALIGNMENT, "A free block header must fit in the smallest allocation.");
+
+static u64 aligned_size(u64 size)
+{
+    if (size == 0)
+        size = 1;
+    return (size + (DYNAMIC_ALLOCATOR_ALIGNMENT - 1)) & ~((u64)DYNAMIC_ALLOCATOR_ALIGNMENT - 1);
+}
+
+b8 dynamic_allocator_create(u64 total_size, void* memory, dynamic_allocator* out_allocator)
+{
+    if (!out_allocator || !memory || total_size < DYNAMIC_ALLOCATOR_ALIGNMENT) {
+        KERROR("dynamic_allocator_create requires a valid memory block and out_allocator.");
+        return FALSE;
+    }
+
+    if ((u64)memory & (DYNAMIC_ALLOCATOR_ALIGNMENT - 1)) {
+        KERROR("dynamic_allocator_create - memory block must be aligned to %i bytes.", DYNAMIC_ALLOCATOR_ALIGNMENT);
+        return FALSE;
+    }
+
+    // Only whole aligned units are usable.
+    total_size &= ~((u64)DYNAMIC_ALLOCATOR_ALIGNMENT - 1);
+
+    out_allocator->total_size = total_size;
+    out_allocator->free_space = total_size;
+    out_allocator->memory = memory;
+
+    // The whole block starts out as one free region.
+    out_allocator->head = (dynamic_allocator_block*)memory;
+    out_allocator->head->size = total_size;
+    out_allocator->head->next = 0;
+
+    return TRUE;
+}
+
+void dynamic_allocator_destroy(dynamic_allocator* allocator)
+{
+    if (allocator) {
+        allocator->total_size = 0;
+        allocator->free_space = 0;
+        allocator->memory = 0;
+        allocator->head = 0;
+    }
+}
+
+void* dynamic_allocator_allocate(dynamic_allocator* allocator, u64 size)
+{
+    return dynamic_allocator_allocate_aligned(allocator, size, DYNAMIC_ALLOCATOR_ALIGNMENT);
+}
+
+void* dynamic_allocator_allocate_aligned(dynamic_allocator* allocator, u64 size, u64 alignment)
+{
+    if (!allocator || !allocator->memory)
+        return 0;
+
+    if (alignment < DYNAMIC_ALLOCATOR_ALIGNMENT)
+        alignment = DYNAMIC_ALLOCATOR_ALIGNMENT;
+
+    if (alignment & (alignment - 1)) {
+        KERROR("dynamic_allocator_allocate_aligned - alignment must be a power of two, got %llu.", alignment);
+        return 0;
+    }
+
+    size = aligned_size(size);
+
+    dynamic_allocator_block* previous = 0;
+    dynamic_allocator_block* node = allocator->head;
+
+    while (node) {
+        u64 start = ((u64)node + (alignment - 1)) & ~(alignment - 1);
+        u64 padding = start - (u64)node;
+
+        if (padding + size <= node->size) {
+            u64 remaining = node->size - padding - size;
+            dynamic_allocator_block* next = node->next;
+
+            // Whatever is left behind the allocation stays free.
+            if (remaining > 0) {
+                dynamic_allocator_block* remainder = (dynamic_allocator_block*)(start + size);
+                remainder->size = remaining;
+                remainder->next = next;
+                next = remainder;
+            }
+
+            if (padding > 0) {
+                // The front of the region is too small to be aligned, so it stays free as well.
+                node->size = padding;
+                node->next = next;
+            } else if (previous) {
+                previous->next = next;
+            } else {
+                allocator->head = next;
+            }
+
+            allocator->free_space -= size;
+            return (void*)start;
+        }
+
+        previous = node;
+        node = node->next;
+    }
+
+    return 0;
+}
+
+b8 dynamic_allocator_free(dynamic_allocator* allocator, void* block, u64 size)
+{
+    if (!dynamic_allocator_owns(allocator, block)) {
+        KERROR("dynamic_allocator_free - block %p is not owned by this allocator.", block);
+        return FALSE;
+    }
+
+    size = aligned_size(size);
+    dynamic_allocator_block* freed = (dynamic_allocator_block*)block;
+
+    // Find the free regions on either side of the block.
+    dynamic_allocator_block* previous = 0;
+    dynamic_allocator_block* node = allocator->head;
+    while (node && node < freed) {
+        previous = node;
+        node = node->next;
+    }
+
+    if ((node && (u8*)freed + size > (u8*)node) || (previous && (u8*)previous + previous->size > (u8*)freed)) {
+        KERROR("dynamic_allocator_free - double free of block %p detected.", block);
+        return FALSE;
+    }
+
+    freed->size = size;
+
+    // Link in, merging with the next region if it is adjacent.
+    if (node && (u8*)freed + freed->size == (u8*)node) {
+        freed->size += node->size;
+        freed->next = node->next;
+    } else {
+        freed->next = node;
+    }
+
+    // Merge with the previous region if it is adjacent.
+    if (previous) {
+        if ((u8*)previous + previous->size == (u8*)freed) {
+            previous->size += freed->size;
+            previous->next = freed->next;
+        } else {
+            previous->next = freed;
+        }
+    } else {
+        allocator->head = freed;
+    }
+
+    allocator->free_space += size;
+    return TRUE;
+}
+
+b8 dynamic_allocator_resize(dynamic_allocator* allocator, void* block, u64 old_size, u64 new_size)
+{
+    if (!dynamic_allocator_owns(allocator, block))
+        return FALSE;
+
+    old_size = aligned_size(old_size);
+    new_size = aligned_size(new_size);
+
+    if (new_size == old_size)
+        return TRUE;
+
+    if (new_size < old_size)
+        return dynamic_allocator_free(allocator, (u8*)block + new_size, old_size - new_size);
+
+    // Growing only works if the region right behind the block is free and large enough.
+    u8* end = (u8*)block + old_size;
+    u64 needed = new_size - old_size;
+
+    dynamic_allocator_block* previous = 0;
+    dynamic_allocator_block* node = allocator->head;
+    while (node && (u8*)node < end) {
+        previous = node;
+        node = node->next;
+    }
+
+    if ((u8*)node != end || node->size < needed)
+        return FALSE;
+
+    dynamic_allocator_block* next = node->next;
+    if (node->size > needed) {
+        dynamic_allocator_block* remainder = (dynamic_allocator_block*)(end + needed);
+        remainder->size = node->size - needed;
+        remainder->next = next;
+        next = remainder;
+    }
+
+    if (previous)
+        previous->next = next;
+    else
+        allocator->head = next;
+
+    allocator->free_space -= needed;
+    return TRUE;
+}
+
+b8 dynamic_allocator_owns(const dynamic_allocator* allocator, const void* block)
+{
+    if (!allocator || !allocator->memory)
+        return FALSE;
+
+    const u8* start = (const u8*)allocator->memory;
+    return (const u8*)block >= start && (const u8*)block < start + allocator->total_size;
+}
+
+u64 dynamic_allocator_free_space(const dynamic_allocator* allocator)
+{
+    return allocator ? allocator->free_space : 0;
+}
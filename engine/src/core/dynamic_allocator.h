@@ -0,0 +1,82 @@
+#pragma once
+
+#include "defines.h"
+
+struct dynamic_allocator_block;
+
+/**
+ * A general purpose allocator that serves variable sized allocations out of a single
+ * pre-allocated block of memory. Free regions are tracked by an address-ordered free
+ * list stored inside the free regions themselves, so the allocator needs no memory of
+ * its own. Adjacent free regions are coalesced when a block is freed.
+ */
+typedef struct dynamic_allocator {
+    u64 total_size;
+    u64 free_space;
+    void* memory;
+    // Address-ordered list of free regions, stored in the managed memory.
+    struct dynamic_allocator_block* head;
+} dynamic_allocator;
+
+// Allocation sizes are rounded up to, and blocks are aligned to, this many bytes.
+#define DYNAMIC_ALLOCATOR_ALIGNMENT 16
+
+/**
+ * Creates a dynamic allocator over the given block of memory.
+ * @param total_size The size in bytes of the provided memory block.
+ * @param memory The memory block to be managed. Must be aligned to DYNAMIC_ALLOCATOR_ALIGNMENT
+ * and outlive the allocator.
+ * @param out_allocator A pointer to hold the created allocator.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 dynamic_allocator_create(u64 total_size, void* memory, dynamic_allocator* out_allocator);
+
+/**
+ * Destroys the provided allocator. The managed memory block is not freed.
+ * @param allocator A pointer to the allocator to be destroyed.
+ */
+KAPI void dynamic_allocator_destroy(dynamic_allocator* allocator);
+
+/**
+ * Allocates a block of the given size using first fit. The memory is NOT zeroed.
+ * @param allocator A pointer to the allocator to allocate from.
+ * @param size The size in bytes to be allocated.
+ * @returns A pointer to the allocated block, or 0/NULL if no free region is large enough.
+ */
+KAPI void* dynamic_allocator_allocate(dynamic_allocator* allocator, u64 size);
+
+/**
+ * Allocates a block of the given size whose address is a multiple of alignment, using first fit.
+ * The memory is NOT zeroed. Free it with dynamic_allocator_free as any other block.
+ * @param allocator A pointer to the allocator to allocate from.
+ * @param size The size in bytes to be allocated.
+ * @param alignment The required alignment in bytes. Must be a power of two.
+ * @returns A pointer to the allocated block, or 0/NULL if no free region is large enough.
+ */
+KAPI void* dynamic_allocator_allocate_aligned(dynamic_allocator* allocator, u64 size, u64 alignment);
+
+/**
+ * Returns a block to the allocator, coalescing it with adjacent free regions.
+ * @param allocator A pointer to the allocator the block was allocated from.
+ * @param block The block to be freed.
+ * @param size The size in bytes the block was allocated with.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 dynamic_allocator_free(dynamic_allocator* allocator, void* block, u64 size);
+
+/**
+ * Tries to resize a block without moving it. Shrinking always succeeds, the tail is freed.
+ * Growing succeeds only if the region right behind the block is free and large enough.
+ * @param allocator A pointer to the allocator the block was allocated from.
+ * @param block The block to be resized.
+ * @param old_size The size in bytes the block was allocated with.
+ * @param new_size The size in bytes the block should have.
+ * @returns TRUE if the block now has new_size bytes; otherwise FALSE, and the block is untouched.
+ */
+KAPI b8 dynamic_allocator_resize(dynamic_allocator* allocator, void* block, u64 old_size, u64 new_size);
+
+// Returns TRUE if the given block lies inside the memory managed by the allocator.
+KAPI b8 dynamic_allocator_owns(const dynamic_allocator* allocator, const void* block);
+
+// Returns the amount of free space in bytes. Not necessarily contiguous.
+KAPI u64 dynamic_allocator_free_space(const dynamic_allocator* allocator);
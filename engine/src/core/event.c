@@ -1,23 +1,36 @@
 #include "event.h"
 
 #include "containers/darray.h"
+#include "containers/hashtable.h"
 #include "core/kmemory.h"
+#include "core/logger.h"
 
 typedef struct registered_event {
     void* listener;
     PFN_on_event callback;
 } registered_event;
 
+// Most codes only ever have a listener or two, so the first few live in the entry itself.
+#define INLINE_LISTENERS 3
+
+/**
+ * The listeners of one event code, in registration order. The first INLINE_LISTENERS are stored
+ * inline and the rest in a darray, so firing a common event reads a single cache line.
+ */
 typedef struct event_code_entry {
-    registered_event* events;
+    registered_event listeners[INLINE_LISTENERS];
+    // Listeners past the inline ones, or 0/NULL if there are none.
+    registered_event* overflow;
+    u32 count;
 } event_code_entry;
 
-// This should be more than enough codes...
-#define MAX_MESSAGE_CODES 16384
+STATIC_ASSERT(sizeof(event_code_entry) <= 64, "event_code_entry should fit in a cache line.");
 
 typedef struct event_system_state {
-    // Lookup table for event codes
-    event_code_entry registered[MAX_MESSAGE_CODES];
+    // System codes index this directly, and the entries sit back to back.
+    _Alignas(64) event_code_entry system[MAX_EVENT_CODE + 1];
+    // Application codes, keyed by the u16 code. Only codes with listeners have an entry.
+    hashtable application;
 } event_system_state;
 
 /*
@@ -32,6 +45,10 @@ b8 event_initialize()
         return FALSE;
 
     kzero_memory(&state, sizeof(state));
+    if (!hashtable_create(sizeof(u16), sizeof(event_code_entry), 0, FALSE, 0, &state.application)) {
+        KERROR("event_initialize - failed to create the application event table.");
+        return FALSE;
+    }
 
     is_initialized = TRUE;
     return TRUE;
@@ -39,13 +56,38 @@ b8 event_initialize()
 
 void event_shutdown()
 {
-    // Free the event arrays. And objects pointed to should be destroyed on their own.
-    for (u64 i = 0; i < MAX_MESSAGE_CODES; ++i) {
-        if (state.registered[i].events != 0) {
-            darray_destroy(state.registered[i].events);
-            state.registered[i].events = 0;
-        }
+    if (is_initialized == FALSE)
+        return;
+
+    // Free the overflow arrays. And objects pointed to should be destroyed on their own.
+    for (u64 i = 0; i <= MAX_EVENT_CODE; ++i) {
+        if (state.system[i].overflow != 0)
+            darray_destroy(state.system[i].overflow);
+    }
+
+    u64 iterator = 0;
+    event_code_entry* entry;
+    while (hashtable_next(&state.application, &iterator, 0, (void**)&entry)) {
+        if (entry->overflow != 0)
+            darray_destroy(entry->overflow);
     }
+    hashtable_destroy(&state.application);
+
+    kzero_memory(&state, sizeof(state));
+    is_initialized = FALSE;
+}
+
+// Returns the entry for the code, or 0/NULL if nothing has registered for it. Only valid until the next registration.
+static event_code_entry* entry_find(u16 code)
+{
+    if (code <= MAX_EVENT_CODE)
+        return &state.system[code];
+    return hashtable_find(&state.application, &code);
+}
+
+static registered_event* entry_listener(event_code_entry* entry, u32 index)
+{
+    return index < INLINE_LISTENERS ? &entry->listeners[index] : &entry->overflow[index - INLINE_LISTENERS];
 }
 
 b8 event_register(u16 code, void* listener, PFN_on_event on_event)
@@ -53,14 +95,18 @@ b8 event_register(u16 code, void* listener, PFN_on_event on_event)
     if (is_initialized == FALSE)
         return FALSE;
 
-    if (state.registered[code].events == 0) {
-        state.registered[code].events = darray_create(registered_event);
+    event_code_entry* entry = entry_find(code);
+    if (entry == 0) {
+        event_code_entry empty = {0};
+        if (!hashtable_set(&state.application, &code, &empty))
+            return FALSE;
+        entry = hashtable_find(&state.application, &code);
     }
 
-    u64 registered_count = darray_length(state.registered[code].events);
-    for (u64 i = 0; i < registered_count; ++i) {
-        if (state.registered[code].events[i].listener == listener) {
-            // TODO: Warn user that the event is duplicate
+    for (u32 i = 0; i < entry->count; ++i) {
+        registered_event* e = entry_listener(entry, i);
+        if (e->listener == listener && e->callback == on_event) {
+            KWARN("event_register - this listener and callback are already registered for code %hu.", code);
             return FALSE;
         }
     }
@@ -69,7 +115,14 @@ b8 event_register(u16 code, void* listener, PFN_on_event on_event)
     registered_event event;
     event.listener = listener;
     event.callback = on_event;
-    darray_push(state.registered[code].events, event);
+    if (entry->count < INLINE_LISTENERS) {
+        entry->listeners[entry->count] = event;
+    } else {
+        if (entry->overflow == 0)
+            entry->overflow = darray_create(registered_event);
+        darray_push(entry->overflow, event);
+    }
+    entry->count++;
 
     return TRUE;
 }
@@ -79,23 +132,34 @@ b8 event_unregister(u16 code, void* listener, PFN_on_event on_event)
     if (is_initialized == FALSE)
         return FALSE;
 
-    // On nothing registered for the code, boot out
-    if (state.registered[code].events == 0) {
-        // TODO: Warn user that the they are trying to delete a unregisred event
+    event_code_entry* entry = entry_find(code);
+    if (entry == 0 || entry->count == 0) {
+        KWARN("event_unregister - nothing is registered for code %hu.", code);
         return FALSE;
     }
 
-    u64 registered_count = darray_length(state.registered[code].events);
-
-    for (u64 i = 0; i < registered_count; ++i) {
-        registered_event e = state.registered[code].events[i];
+    for (u32 i = 0; i < entry->count; ++i) {
+        registered_event* e = entry_listener(entry, i);
+        if (e->listener != listener || e->callback != on_event)
+            continue;
+
+        // Found one, remove it. Listeners are called in registration order, so keep that order.
+        if (i < INLINE_LISTENERS) {
+            kmove_memory(&entry->listeners[i], &entry->listeners[i + 1], (INLINE_LISTENERS - 1 - i) * sizeof(registered_event));
+            if (entry->count > INLINE_LISTENERS)
+                darray_pop_at(entry->overflow, 0, &entry->listeners[INLINE_LISTENERS - 1]);
+        } else {
+            darray_pop_at(entry->overflow, i - INLINE_LISTENERS, 0);
+        }
+        entry->count--;
 
-        if (e.listener == listener && e.callback == on_event) {
-            // Found one remove it
-            registered_event popped_event;
-            darray_pop_at(state.registered[code].events, i, &popped_event);
-            return TRUE;
+        if (entry->count <= INLINE_LISTENERS && entry->overflow != 0) {
+            darray_destroy(entry->overflow);
+            entry->overflow = 0;
         }
+        if (entry->count == 0 && code > MAX_EVENT_CODE)
+            hashtable_remove(&state.application, &code);
+        return TRUE;
     }
 
     // Event not found
@@ -107,20 +171,30 @@ b8 event_fire(u16 code, void* sender, event_context context)
     if (is_initialized == FALSE)
         return FALSE;
 
-    if (state.registered[code].events == 0) {
-        // TODO: Warn user that the they are trying to delete a unregisred event
-        return FALSE;
-    }
+    // A callback may register or unregister listeners, which can move the entry and its overflow
+    // array, so look the entry up again before each call rather than holding on to it.
+    u32 i = 0;
+    for (;;) {
+        event_code_entry* entry = entry_find(code);
+        if (entry == 0 || i >= entry->count)
+            return FALSE;
 
-    u64 register_count = darray_length(state.registered[code].events);
-    for (u64 i = 0; i < register_count; ++i) {
-        registered_event e = state.registered[code].events[i];
+        registered_event e = *entry_listener(entry, i);
         if (e.callback(code, sender, e.listener, context)) {
             // Message has been handled, do not send to other listeners.
             return TRUE;
         }
-    }
 
-    // Event not found
-    return FALSE;
-}
\ No newline at end of file
+        // If the callback unregistered itself, or a listener before it, the rest shifted down and
+        // i already names the next listener. Registrations are unique, so compare both fields.
+        entry = entry_find(code);
+        if (entry == 0)
+            return FALSE;
+        if (i < entry->count) {
+            registered_event* current = entry_listener(entry, i);
+            if (current->listener != e.listener || current->callback != e.callback)
+                continue;
+        }
+        ++i;
+    }
+}
@@ -29,13 +29,13 @@ typedef struct event_context {
 // Should return true if handled
 typedef b8 (*PFN_on_event)(u16 code, void* sender, void* listener_inst, event_context data);
 
-b8 event_initialize();
-void event_shutdown();
+KAPI b8 event_initialize();
+KAPI void event_shutdown();
 
 /**
  * Register to listen for when events are sent with the provided code. Events with duplicate
  * listener/callback combos will not be registered again and will cause this to return FALSE.
- * @param code The event code to listen for.
+ * @param code The event code to listen for. Any u16 value is valid.
  * @param listener A pointer to a listener instance. Can be 0/NULL.
  * @param on_event The callback function pointer to be invoked when the event code is fired.
  * @returns TRUE if the event is successfully registered; otherwise false.
@@ -54,7 +54,9 @@ KAPI b8 event_unregister(u16 code, void* listener, PFN_on_event on_event);
 
 /**
  * Fires an event to listeners of the given code. If an event handler returns 
- * TRUE, the event is considered handled and is not passed on to any more listeners.
+ * TRUE, the event is considered handled and is not passed on to any more listeners. Handlers may
+ * register and unregister listeners, including themselves. Listeners registered for this code while
+ * it fires are called too, and listeners unregistered before their turn are not.
  * @param code The event code to fire.
  * @param sender A pointer to the sender. Can be 0/NULL.
  * @param data The event data.
@@ -111,5 +113,20 @@ typedef enum system_event_code {
      */
     EVENT_CODE_RESIZED = 0x08,
 
+    // A memory tag went over its soft budget. Fired at the end of the frame.
+    /* Context usage:
+     * memory_tag tag = data.data.u32[0];
+     * u64 allocated = data.data.u64[1];
+     */
+    EVENT_CODE_MEMORY_SOFT_BUDGET_EXCEEDED = 0x09,
+
+    // A kvirtual_commit was refused because it would have taken a memory tag over its hard budget. Fired
+    // at the end of the frame. An allocation over a hard budget aborts instead, without an event.
+    /* Context usage:
+     * memory_tag tag = data.data.u32[0];
+     * u64 requested = data.data.u64[1];
+     */
+    EVENT_CODE_MEMORY_HARD_BUDGET_EXCEEDED = 0x0A,
+
     MAX_EVENT_CODE = 0xFF
 } system_event_code;
\ No newline at end of file
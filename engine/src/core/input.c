@@ -1,13 +1,17 @@
 #include "input.h"
 
+#include "containers/bitset.h"
 #include "core/event.h"
 #include "core/kmemory.h"
 #include "core/logger.h"
 
 typedef struct keyboard_state {
-    b8 keys[256];
+    // One bit per key, so the whole state is copied in two vector moves each frame.
+    bitset256 keys;
 } keyboard_state;
 
+STATIC_ASSERT(KEYS_MAX_KEYS <= 256, "Every key code must fit in the keyboard bitset.");
+
 typedef struct mouse_state {
     i16 x;
     i16 y;
@@ -51,9 +55,9 @@ void input_update(f64 delta_time)
 void input_process_key(keys key, b8 pressed)
 {
     // Only handle this if the state actually changed
-    if (state.keyboard_current.keys[key] != pressed) {
+    if (bitset256_test(&state.keyboard_current.keys, key) != pressed) {
         // Update internal state
-        state.keyboard_current.keys[key] = pressed;
+        bitset256_assign(&state.keyboard_current.keys, key, pressed);
 
         // Fire off an event for immediate processing
         event_context context;
@@ -110,7 +114,7 @@ b8 input_is_key_down(keys key)
     if (!initialized)
         return FALSE;
 
-    return state.keyboard_current.keys[key] == TRUE;
+    return bitset256_test(&state.keyboard_current.keys, key);
 }
 
 b8 input_is_key_up(keys key)
@@ -118,7 +122,7 @@ b8 input_is_key_up(keys key)
     if (!initialized)
         return FALSE;
 
-    return state.keyboard_current.keys[key] == FALSE;
+    return !bitset256_test(&state.keyboard_current.keys, key);
 }
 
 b8 input_was_key_down(keys key)
@@ -126,7 +130,7 @@ b8 input_was_key_down(keys key)
     if (!initialized)
         return FALSE;
 
-    return state.keyboard_previous.keys[key] == TRUE;
+    return bitset256_test(&state.keyboard_previous.keys, key);
 }
 
 b8 input_was_key_up(keys key)
@@ -134,7 +138,7 @@ b8 input_was_key_up(keys key)
     if (!initialized)
         return FALSE;
 
-    return state.keyboard_previous.keys[key] == FALSE;
+    return !bitset256_test(&state.keyboard_previous.keys, key);
 }
 
 void input_get_mouse_position(i32* x, i32* y)
@@ -1,17 +1,46 @@
 #include "kmemory.h"
 
+// The tracking macros in kmemory.h must not rename the definitions below.
+#undef kallocate
+#undef kallocate_aligned
+#undef kallocate_uninitialized
+#undef kallocate_aligned_uninitialized
+#undef kreallocate
+
+#include "core/dynamic_allocator.h"
+#include "core/event.h"
+#include "core/kstring.h"
 #include "core/logger.h"
 #include "platform/platform.h"
 
-#include <stdio.h>
-// TODO: Custom string lib
-#include <string.h>
+#include <stdlib.h>
+
+typedef struct memory_tag_counters {
+    // Bytes currently allocated.
+    u64 allocated;
+    // Bytes ever allocated. Bytes ever freed are this minus allocated.
+    u64 allocated_total;
+    u64 allocation_count;
+    u64 free_count;
+} memory_tag_counters;
 
 typedef struct memory_stats {
     u64 total_allocated;
-    u64 tagged_allocations[MEMORY_TAG_MAX_TAGS];
+    memory_tag_counters tags[MEMORY_TAG_MAX_TAGS];
 } memory_stats;
 
+/**
+ * Stats are split into per-thread shards so that allocating threads never contend on the
+ * same counters or cache line. Each shard is only ever written by the thread that owns it,
+ * and a read sums every shard. Since frees on one thread may be matched by allocations on
+ * another, a single shard may wrap around, but the unsigned sum across shards is exact.
+ */
+#define MEMORY_STATS_MAX_SHARDS 64
+
+typedef struct memory_stats_shard {
+    _Alignas(64) memory_stats stats;
+} memory_stats_shard;
+
 static const char* memory_tag_strings[MEMORY_TAG_MAX_TAGS] = {
     "UNKNOWN    ",
     "ARRAY      ",
@@ -29,43 +58,1014 @@ static const char* memory_tag_strings[MEMORY_TAG_MAX_TAGS] = {
     "TRANSFORM  ",
     "ENTITY     ",
     "ENTITY_NODE",
-    "SCENE      "
+    "SCENE      ",
+    "LINEAR_ALLC"
 };
 
-static memory_stats stats;
+// Budgets and the per-frame view of a single tag. Only touched by the main thread, apart from peak_allocated and hard_exceeded_size.
+typedef struct memory_tag_state {
+    u64 soft_budget;
+    // Sampled at the end of every frame and whenever stats are read, by whichever thread reads them.
+    u64 peak_allocated;
+
+    // The cumulative counters as they were at the end of the previous frame.
+    memory_tag_counters frame_start;
+    // How much the counters moved during the last completed frame.
+    memory_tag_counters frame_delta;
+    u64 frame_freed;
+
+    // Set once the soft budget is crossed, cleared when usage drops back under it.
+    b8 soft_exceeded;
+
+    // The usage a refused commit would have reached, or 0. Written by any thread, reported at the end of the frame.
+    u64 hard_exceeded_size;
+} memory_tag_state;
+
+/**
+ * The hard budget of a tag, along with its usage. The shards would give the usage too, but summing
+ * them on every allocation reads cache lines every other thread is writing. Instead the usage is
+ * kept in one place, and only while the tag has a hard budget, so unbudgeted tags never pay for it.
+ * Budgeted tags pay an atomic add per allocation and free on a line of their own.
+ */
+typedef struct memory_tag_budget {
+    _Alignas(64) u64 hard_budget;
+    u64 allocated;
+} memory_tag_budget;
+
+#if KMEMORY_TRACKING_ENABLED
+// A live allocation.
+typedef struct memory_allocation_record {
+    void* block;
+    u64 size;
+    const char* file;
+    u32 line;
+    u16 tag;
+} memory_allocation_record;
+
+// Everything allocated from a single file/line.
+typedef struct memory_callsite_record {
+    const char* file;
+    u32 line;
+    u16 tag;
+    u64 allocation_count;
+    u64 allocated_bytes;
+    u64 live_count;
+    u64 live_bytes;
+} memory_callsite_record;
+
+/**
+ * Open addressing hash table with linear probing, used for both allocation and callsite
+ * records. Backed by the platform directly so tracking never shows up in the stats it
+ * helps explain, and never recurses into kallocate.
+ */
+typedef struct memory_tracking_table {
+    void* entries;
+    u64 stride;
+    u64 capacity;
+    u64 count;
+} memory_tracking_table;
+
+// How many of the heaviest callsites are listed in a report.
+#define MEMORY_TRACKING_TOP_CALLSITES 10
+#endif
+
+typedef struct memory_system_state {
+    memory_system_configuration config;
+
+    memory_stats_shard shards[MEMORY_STATS_MAX_SHARDS];
+    u32 shard_count;
+
+    // Used by threads beyond MEMORY_STATS_MAX_SHARDS. Shared, so updated with atomic adds.
+    memory_stats_shard overflow_shard;
+
+    memory_tag_state tags[MEMORY_TAG_MAX_TAGS];
+    memory_tag_budget budgets[MEMORY_TAG_MAX_TAGS];
+
+    // Guards the dynamic allocator and the heap fallback bookkeeping.
+    volatile b8 allocator_lock;
+
+    // Serves every allocation that fits in the block reserved at initialization.
+    dynamic_allocator allocator;
+    void* allocator_block;
+    u64 allocator_block_size;
+
+    // Bytes currently allocated from the heap because the reserved block was full.
+    u64 heap_fallback_allocated;
+    b8 heap_fallback_warned;
+
+#if KMEMORY_TRACKING_ENABLED
+    // Guards both tracking tables.
+    volatile b8 tracking_lock;
+    memory_tracking_table allocations;
+    memory_tracking_table callsites;
+#endif
+} memory_system_state;
+
+static memory_system_state state;
+
+// The shard owned by the calling thread, claimed on its first allocation.
+static _Thread_local memory_stats_shard* thread_shard = 0;
+
+// How many times a waiting thread checks the lock before giving its time slice to another thread.
+#define SPIN_LOCK_SPIN_COUNT 128
+
+/**
+ * Spins briefly, since the locks are only ever held for a handful of list operations, then yields.
+ * A holder that was preempted can only finish once it is scheduled again, so spinning on past
+ * that point would just burn the waiting thread's time slice for nothing.
+ */
+static void spin_lock(volatile b8* lock)
+{
+    u32 spins = 0;
+    while (__atomic_test_and_set(lock, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(lock, __ATOMIC_RELAXED)) {
+            if (++spins < SPIN_LOCK_SPIN_COUNT) {
+#if defined(__x86_64__) || defined(_M_X64)
+                __builtin_ia32_pause();
+#endif
+            } else {
+                spins = 0;
+                platform_yield();
+            }
+        }
+    }
+}
+
+static void spin_unlock(volatile b8* lock)
+{
+    __atomic_clear(lock, __ATOMIC_RELEASE);
+}
+
+static void allocator_lock()
+{
+    spin_lock(&state.allocator_lock);
+}
+
+static void allocator_unlock()
+{
+    spin_unlock(&state.allocator_lock);
+}
+
+/**
+ * Small and medium blocks are cached per thread in front of the dynamic allocator, so the common
+ * allocate and free pairs never take the allocator lock. Each size class keeps a list threaded
+ * through its free blocks. An empty class is refilled, and a full one drained by half, in a single
+ * lock acquisition. Every block up to THREAD_CACHE_MAX_SIZE is allocated at its class size, cached
+ * or not, so a block can move between a cache and the allocator without any bookkeeping.
+ *
+ * Small classes are as fine as the dynamic allocator's own rounding, so they waste nothing. Medium
+ * classes are coarser, and hold fewer blocks, to bound what a thread can keep to itself at roughly
+ * 400KiB.
+ */
+#define THREAD_CACHE_SMALL_MAX_SIZE 256
+#define THREAD_CACHE_SMALL_CLASS_SIZE DYNAMIC_ALLOCATOR_ALIGNMENT
+#define THREAD_CACHE_SMALL_CLASS_COUNT (THREAD_CACHE_SMALL_MAX_SIZE / THREAD_CACHE_SMALL_CLASS_SIZE)
+#define THREAD_CACHE_MAX_SIZE 2048
+#define THREAD_CACHE_MEDIUM_CLASS_SIZE 128
+#define THREAD_CACHE_MEDIUM_CLASS_COUNT ((THREAD_CACHE_MAX_SIZE - THREAD_CACHE_SMALL_MAX_SIZE) / THREAD_CACHE_MEDIUM_CLASS_SIZE)
+#define THREAD_CACHE_CLASS_COUNT (THREAD_CACHE_SMALL_CLASS_COUNT + THREAD_CACHE_MEDIUM_CLASS_COUNT)
+// The most blocks a size class holds before half of them go back to the allocator.
+#define THREAD_CACHE_SMALL_CLASS_CAPACITY 64
+#define THREAD_CACHE_MEDIUM_CLASS_CAPACITY 16
+// How many blocks an empty size class takes from the allocator at once.
+#define THREAD_CACHE_SMALL_REFILL_COUNT 16
+#define THREAD_CACHE_MEDIUM_REFILL_COUNT 8
+
+typedef struct thread_cache_class {
+    void* head;
+    u32 count;
+} thread_cache_class;
+
+typedef struct thread_cache {
+    // The memory system generation the cached blocks came from.
+    u32 generation;
+    thread_cache_class classes[THREAD_CACHE_CLASS_COUNT];
+} thread_cache;
+
+static _Thread_local thread_cache cache;
+
+// Bumped by every initialize_memory, so threads drop blocks cached from an earlier reserved block.
+static u32 memory_generation = 0;
+
+static thread_cache* thread_cache_get()
+{
+    u32 generation = __atomic_load_n(&memory_generation, __ATOMIC_RELAXED);
+    if (cache.generation != generation) {
+        platform_zero_memory(&cache, sizeof(thread_cache));
+        cache.generation = generation;
+    }
+    return &cache;
+}
+
+// The class of a size no larger than THREAD_CACHE_MAX_SIZE.
+static u32 thread_cache_class_index(u64 size)
+{
+    if (size <= THREAD_CACHE_SMALL_MAX_SIZE)
+        return size ? (u32)((size - 1) / THREAD_CACHE_SMALL_CLASS_SIZE) : 0;
+    return THREAD_CACHE_SMALL_CLASS_COUNT + (u32)((size - THREAD_CACHE_SMALL_MAX_SIZE - 1) / THREAD_CACHE_MEDIUM_CLASS_SIZE);
+}
+
+static u64 thread_cache_class_size(u32 index)
+{
+    if (index < THREAD_CACHE_SMALL_CLASS_COUNT)
+        return (u64)(index + 1) * THREAD_CACHE_SMALL_CLASS_SIZE;
+    return THREAD_CACHE_SMALL_MAX_SIZE + (u64)(index - THREAD_CACHE_SMALL_CLASS_COUNT + 1) * THREAD_CACHE_MEDIUM_CLASS_SIZE;
+}
+
+static u32 thread_cache_class_capacity(u32 index)
+{
+    return index < THREAD_CACHE_SMALL_CLASS_COUNT ? THREAD_CACHE_SMALL_CLASS_CAPACITY : THREAD_CACHE_MEDIUM_CLASS_CAPACITY;
+}
 
-void initialize_memory()
+// The size the dynamic allocator is asked for when size bytes are allocated.
+static u64 block_size_get(u64 size)
 {
-    platform_zero_memory(&stats, sizeof(memory_stats));
+    return size <= THREAD_CACHE_MAX_SIZE ? thread_cache_class_size(thread_cache_class_index(size)) : size;
+}
+
+// Returns a block of at least size bytes, or 0/NULL if the reserved block is out of room.
+static void* thread_cache_allocate(u64 size)
+{
+    u32 index = thread_cache_class_index(size);
+    thread_cache_class* class = &thread_cache_get()->classes[index];
+
+    if (!class->head) {
+        u64 class_size = thread_cache_class_size(index);
+        u32 refill_count = index < THREAD_CACHE_SMALL_CLASS_COUNT ? THREAD_CACHE_SMALL_REFILL_COUNT : THREAD_CACHE_MEDIUM_REFILL_COUNT;
+        allocator_lock();
+        for (u32 i = 0; i < refill_count; ++i) {
+            void* block = dynamic_allocator_allocate(&state.allocator, class_size);
+            if (!block)
+                break;
+            *(void**)block = class->head;
+            class->head = block;
+            class->count++;
+        }
+        allocator_unlock();
+
+        if (!class->head)
+            return 0;
+    }
+
+    void* block = class->head;
+    class->head = *(void**)block;
+    class->count--;
+    return block;
+}
+
+// Returns count blocks from the front of the class to the allocator. The allocator lock must be held.
+static void thread_cache_drain(thread_cache_class* class, u32 index, u32 count)
+{
+    u64 class_size = thread_cache_class_size(index);
+    for (u32 i = 0; i < count; ++i) {
+        void* block = class->head;
+        class->head = *(void**)block;
+        class->count--;
+        dynamic_allocator_free(&state.allocator, block, class_size);
+    }
+}
+
+static void thread_cache_free(void* block, u64 size)
+{
+    u32 index = thread_cache_class_index(size);
+    thread_cache_class* class = &thread_cache_get()->classes[index];
+
+    *(void**)block = class->head;
+    class->head = block;
+    class->count++;
+
+    u32 capacity = thread_cache_class_capacity(index);
+    if (class->count >= capacity) {
+        allocator_lock();
+        thread_cache_drain(class, index, capacity / 2);
+        allocator_unlock();
+    }
+}
+
+void kmemory_thread_cache_flush()
+{
+    thread_cache* thread_cache = thread_cache_get();
+
+    allocator_lock();
+    for (u32 i = 0; i < THREAD_CACHE_CLASS_COUNT; ++i)
+        thread_cache_drain(&thread_cache->classes[i], i, thread_cache->classes[i].count);
+    allocator_unlock();
+}
+
+static void stats_add(u64* counter, u64 delta, b8 shared)
+{
+    if (shared) {
+        __atomic_fetch_add(counter, delta, __ATOMIC_RELAXED);
+    } else {
+        // Single writer, so a plain read-modify-write is enough. The atomic store keeps concurrent readers tear-free.
+        __atomic_store_n(counter, *counter + delta, __ATOMIC_RELAXED);
+    }
+}
+
+// Accounts for size bytes being allocated (is_allocation TRUE) or freed under the tag.
+static void stats_record(memory_tag tag, u64 size, b8 is_allocation)
+{
+    if (!thread_shard) {
+        u32 index = __atomic_fetch_add(&state.shard_count, 1, __ATOMIC_RELAXED);
+        thread_shard = index < MEMORY_STATS_MAX_SHARDS ? &state.shards[index] : &state.overflow_shard;
+    }
+
+    memory_stats* stats = &thread_shard->stats;
+    memory_tag_counters* counters = &stats->tags[tag];
+    b8 shared = thread_shard == &state.overflow_shard;
+    memory_tag_budget* budget = &state.budgets[tag];
+
+    if (is_allocation) {
+        stats_add(&stats->total_allocated, size, shared);
+        stats_add(&counters->allocated, size, shared);
+        stats_add(&counters->allocated_total, size, shared);
+        stats_add(&counters->allocation_count, 1, shared);
+        if (__atomic_load_n(&budget->hard_budget, __ATOMIC_RELAXED))
+            __atomic_fetch_add(&budget->allocated, size, __ATOMIC_RELAXED);
+    } else {
+        stats_add(&stats->total_allocated, -size, shared);
+        stats_add(&counters->allocated, -size, shared);
+        stats_add(&counters->free_count, 1, shared);
+        if (__atomic_load_n(&budget->hard_budget, __ATOMIC_RELAXED))
+            __atomic_fetch_sub(&budget->allocated, size, __ATOMIC_RELAXED);
+    }
+}
+
+static u32 stats_shard_count()
+{
+    u32 shard_count = __atomic_load_n(&state.shard_count, __ATOMIC_RELAXED);
+    return shard_count > MEMORY_STATS_MAX_SHARDS ? MEMORY_STATS_MAX_SHARDS : shard_count;
+}
+
+static const memory_stats* stats_shard(u32 index, u32 shard_count)
+{
+    return index < shard_count ? &state.shards[index].stats : &state.overflow_shard.stats;
+}
+
+// Sums every shard into out_stats.
+static void stats_aggregate(memory_stats* out_stats)
+{
+    platform_zero_memory(out_stats, sizeof(memory_stats));
+
+    u32 shard_count = stats_shard_count();
+    for (u32 i = 0; i <= shard_count; ++i) {
+        const memory_stats* stats = stats_shard(i, shard_count);
+
+        out_stats->total_allocated += __atomic_load_n(&stats->total_allocated, __ATOMIC_RELAXED);
+        for (u32 tag = 0; tag < MEMORY_TAG_MAX_TAGS; ++tag) {
+            const memory_tag_counters* counters = &stats->tags[tag];
+            memory_tag_counters* out_counters = &out_stats->tags[tag];
+            out_counters->allocated += __atomic_load_n(&counters->allocated, __ATOMIC_RELAXED);
+            out_counters->allocated_total += __atomic_load_n(&counters->allocated_total, __ATOMIC_RELAXED);
+            out_counters->allocation_count += __atomic_load_n(&counters->allocation_count, __ATOMIC_RELAXED);
+            out_counters->free_count += __atomic_load_n(&counters->free_count, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// Sums the bytes currently allocated under a single tag, without touching the other tags.
+static u64 stats_tag_allocated(memory_tag tag)
+{
+    u64 allocated = 0;
+    u32 shard_count = stats_shard_count();
+    for (u32 i = 0; i <= shard_count; ++i)
+        allocated += __atomic_load_n(&stats_shard(i, shard_count)->tags[tag].allocated, __ATOMIC_RELAXED);
+    return allocated;
+}
+
+/**
+ * Raises the tag's peak to the usage just read from the shards. Stats can be read from any thread,
+ * so this is an atomic max.
+ */
+static void tag_peak_sample(memory_tag tag, u64 allocated)
+{
+    u64* peak = &state.tags[tag].peak_allocated;
+    u64 current = __atomic_load_n(peak, __ATOMIC_RELAXED);
+    while (allocated > current && !__atomic_compare_exchange_n(peak, &current, allocated, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/**
+ * Checks an allocation of size bytes against the tag's hard budget, if it has one. The check is
+ * not atomic with the allocation itself, so threads racing on the same tag may overshoot it slightly.
+ * @returns The usage the allocation would take the tag to if that is past the budget; otherwise 0.
+ */
+static u64 budget_exceeded(memory_tag tag, u64 size)
+{
+    const memory_tag_budget* budget = &state.budgets[tag];
+    u64 hard_budget = __atomic_load_n(&budget->hard_budget, __ATOMIC_RELAXED);
+    if (!hard_budget)
+        return 0;
+
+    u64 requested = __atomic_load_n(&budget->allocated, __ATOMIC_RELAXED) + size;
+    return requested > hard_budget ? requested : 0;
+}
+
+static void budget_event_fire(u16 code, memory_tag tag, u64 allocated)
+{
+    event_context context = { 0 };
+    context.data.u32[0] = tag;
+    context.data.u64[1] = allocated;
+    event_fire(code, 0, context);
+}
+
+/**
+ * Stops the engine if an allocation would take the tag past its hard budget. Nothing that calls
+ * kallocate is written to cope with it failing, so the budget is enforced rather than reported.
+ * No event is fired: the allocating thread may not be the main thread, and the engine does not
+ * live to see the end of the frame.
+ */
+static void budget_enforce(memory_tag tag, u64 size)
+{
+    u64 requested = budget_exceeded(tag, size);
+    if (!requested)
+        return;
+
+    KFATAL("Memory tag %s went over its hard budget of %lluB with %lluB, stopping.", memory_tag_strings[tag], state.budgets[tag].hard_budget, requested);
+    abort();
+}
+
+#if KMEMORY_TRACKING_ENABLED
+static u64 tracking_hash(const void* a, u64 b)
+{
+    // Pointer and line mix, finalized with the murmur3 64-bit mixer.
+    u64 h = (u64)a ^ (b * 0x9E3779B97F4A7C15ULL);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static b8 tracking_table_create(u64 stride, u64 capacity, memory_tracking_table* out_table)
+{
+    out_table->entries = platform_allocate(stride * capacity, FALSE);
+    if (!out_table->entries)
+        return FALSE;
+
+    platform_zero_memory(out_table->entries, stride * capacity);
+    out_table->stride = stride;
+    out_table->capacity = capacity;
+    out_table->count = 0;
+    return TRUE;
+}
+
+static void tracking_table_destroy(memory_tracking_table* table)
+{
+    if (table->entries)
+        platform_free(table->entries, FALSE);
+    platform_zero_memory(table, sizeof(memory_tracking_table));
+}
+
+// Both record types start with a pointer key, which is 0 in empty slots.
+static void* tracking_slot(const memory_tracking_table* table, u64 index)
+{
+    return (u8*)table->entries + index * table->stride;
+}
+
+static u64 allocation_slot_index(const memory_tracking_table* table, const void* block)
+{
+    u64 mask = table->capacity - 1;
+    u64 index = tracking_hash(block, 0) & mask;
+    while (TRUE) {
+        memory_allocation_record* record = tracking_slot(table, index);
+        if (record->block == block || record->block == 0)
+            return index;
+        index = (index + 1) & mask;
+    }
+}
+
+static u64 callsite_slot_index(const memory_tracking_table* table, const char* file, u32 line)
+{
+    u64 mask = table->capacity - 1;
+    u64 index = tracking_hash(file, line) & mask;
+    while (TRUE) {
+        memory_callsite_record* record = tracking_slot(table, index);
+        if (record->file == 0 || (record->file == file && record->line == line))
+            return index;
+        index = (index + 1) & mask;
+    }
+}
+
+// Doubles the table once it is half full, keeping probe sequences short.
+static b8 tracking_table_reserve(memory_tracking_table* table, b8 is_callsite_table)
+{
+    if ((table->count + 1) * 2 <= table->capacity)
+        return TRUE;
+
+    memory_tracking_table grown;
+    if (!tracking_table_create(table->stride, table->capacity * 2, &grown))
+        return FALSE;
+
+    for (u64 i = 0; i < table->capacity; ++i) {
+        void* entry = tracking_slot(table, i);
+        if (*(void**)entry == 0)
+            continue;
+
+        u64 index;
+        if (is_callsite_table) {
+            memory_callsite_record* record = entry;
+            index = callsite_slot_index(&grown, record->file, record->line);
+        } else {
+            index = allocation_slot_index(&grown, *(void**)entry);
+        }
+        platform_copy_memory(tracking_slot(&grown, index), entry, table->stride);
+    }
+
+    grown.count = table->count;
+    tracking_table_destroy(table);
+    *table = grown;
+    return TRUE;
+}
+
+static void tracking_record_allocation(void* block, u64 size, memory_tag tag, const char* file, u32 line)
+{
+    if (!file)
+        file = "<untracked callsite>";
+
+    spin_lock(&state.tracking_lock);
+
+    if (state.allocations.entries && tracking_table_reserve(&state.allocations, FALSE) && tracking_table_reserve(&state.callsites, TRUE)) {
+        memory_allocation_record* allocation = tracking_slot(&state.allocations, allocation_slot_index(&state.allocations, block));
+        allocation->block = block;
+        allocation->size = size;
+        allocation->file = file;
+        allocation->line = line;
+        allocation->tag = tag;
+        state.allocations.count++;
+
+        memory_callsite_record* callsite = tracking_slot(&state.callsites, callsite_slot_index(&state.callsites, file, line));
+        if (callsite->file == 0) {
+            callsite->file = file;
+            callsite->line = line;
+            callsite->tag = tag;
+            state.callsites.count++;
+        }
+        callsite->allocation_count++;
+        callsite->allocated_bytes += size;
+        callsite->live_count++;
+        callsite->live_bytes += size;
+    }
+
+    spin_unlock(&state.tracking_lock);
+}
+
+static void tracking_record_free(void* block, u64 size)
+{
+    spin_lock(&state.tracking_lock);
+
+    if (state.allocations.entries) {
+        u64 mask = state.allocations.capacity - 1;
+        u64 index = allocation_slot_index(&state.allocations, block);
+        memory_allocation_record* allocation = tracking_slot(&state.allocations, index);
+
+        if (allocation->block == 0) {
+            KWARN("kfree - block %p was not allocated by kallocate, or was already freed.", block);
+        } else {
+            if (allocation->size != size) {
+                KWARN("kfree - block %p allocated at %s:%u with %lluB is being freed with %lluB.",
+                    block, allocation->file, allocation->line, allocation->size, size);
+            }
+
+            memory_callsite_record* callsite = tracking_slot(&state.callsites, callsite_slot_index(&state.callsites, allocation->file, allocation->line));
+            callsite->live_count--;
+            callsite->live_bytes -= allocation->size;
+
+            // Backward shift deletion, so lookups never need tombstones.
+            u64 hole = index;
+            u64 next = (index + 1) & mask;
+            while (TRUE) {
+                memory_allocation_record* candidate = tracking_slot(&state.allocations, next);
+                if (candidate->block == 0)
+                    break;
+
+                u64 home = tracking_hash(candidate->block, 0) & mask;
+                // Move the candidate into the hole unless its home lies cyclically in (hole, next].
+                b8 stays = hole <= next ? (home > hole && home <= next) : (home > hole || home <= next);
+                if (!stays) {
+                    platform_copy_memory(tracking_slot(&state.allocations, hole), candidate, sizeof(memory_allocation_record));
+                    hole = next;
+                }
+                next = (next + 1) & mask;
+            }
+            platform_zero_memory(tracking_slot(&state.allocations, hole), sizeof(memory_allocation_record));
+            state.allocations.count--;
+        }
+    }
+
+    spin_unlock(&state.tracking_lock);
+}
+
+static void tracking_report(b8 at_shutdown)
+{
+    spin_lock(&state.tracking_lock);
+
+    if (!state.callsites.entries) {
+        spin_unlock(&state.tracking_lock);
+        return;
+    }
+
+    // Pick the heaviest callsites, by total bytes ever allocated.
+    memory_callsite_record* top[MEMORY_TRACKING_TOP_CALLSITES] = { 0 };
+    u64 leaked_bytes = 0;
+    u64 leaked_count = 0;
+
+    for (u64 i = 0; i < state.callsites.capacity; ++i) {
+        memory_callsite_record* callsite = tracking_slot(&state.callsites, i);
+        if (callsite->file == 0)
+            continue;
+
+        leaked_bytes += callsite->live_bytes;
+        leaked_count += callsite->live_count;
+
+        for (u32 j = 0; j < MEMORY_TRACKING_TOP_CALLSITES; ++j) {
+            if (!top[j] || top[j]->allocated_bytes < callsite->allocated_bytes) {
+                for (u32 k = MEMORY_TRACKING_TOP_CALLSITES - 1; k > j; --k)
+                    top[k] = top[k - 1];
+                top[j] = callsite;
+                break;
+            }
+        }
+    }
+
+    if (at_shutdown && leaked_count > 0) {
+        KWARN("Memory leaks detected: %llu allocations totaling %lluB were never freed.", leaked_count, leaked_bytes);
+        for (u64 i = 0; i < state.callsites.capacity; ++i) {
+            memory_callsite_record* callsite = tracking_slot(&state.callsites, i);
+            if (callsite->file && callsite->live_count > 0) {
+                KWARN("  %s:%u (%s) leaked %llu allocations, %lluB.",
+                    callsite->file, callsite->line, memory_tag_strings[callsite->tag], callsite->live_count, callsite->live_bytes);
+            }
+        }
+    } else {
+        KINFO("Live tracked allocations: %llu totaling %lluB.", leaked_count, leaked_bytes);
+    }
+
+    KINFO("Top allocating callsites:");
+    for (u32 i = 0; i < MEMORY_TRACKING_TOP_CALLSITES && top[i]; ++i) {
+        KINFO("  %s:%u (%s) %llu allocations, %lluB total, %llu live.",
+            top[i]->file, top[i]->line, memory_tag_strings[top[i]->tag],
+            top[i]->allocation_count, top[i]->allocated_bytes, top[i]->live_count);
+    }
+
+    spin_unlock(&state.tracking_lock);
+}
+#endif
+
+b8 initialize_memory(memory_system_configuration config)
+{
+    platform_zero_memory(&state, sizeof(memory_system_state));
+    state.config = config;
+
+#if KMEMORY_TRACKING_ENABLED
+    if (!tracking_table_create(sizeof(memory_allocation_record), 4096, &state.allocations)
+        || !tracking_table_create(sizeof(memory_callsite_record), 512, &state.callsites)) {
+        KFATAL("Memory system is unable to create its allocation tracking tables.");
+        return FALSE;
+    }
+#endif
+
+    // Blocks still cached by any thread belong to the previous reserved block, if there was one.
+    __atomic_fetch_add(&memory_generation, 1, __ATOMIC_RELAXED);
+
+    if (config.total_alloc_size == 0)
+        return TRUE;
+
+    if (config.use_large_pages) {
+        // Large pages are committed and locked in memory on reservation, so there is nothing to touch.
+        u64 large_page_size = platform_large_page_size();
+        if (large_page_size) {
+            state.allocator_block_size = (config.total_alloc_size + large_page_size - 1) / large_page_size * large_page_size;
+            state.allocator_block = platform_reserve_memory(state.allocator_block_size, TRUE);
+        }
+
+        if (!state.allocator_block)
+            KWARN("Memory system is unable to use large pages, falling back to regular pages.");
+    }
+
+    if (!state.allocator_block) {
+        u64 page_size = platform_page_size();
+        state.allocator_block_size = (config.total_alloc_size + page_size - 1) / page_size * page_size;
+        state.allocator_block = platform_reserve_memory(state.allocator_block_size, FALSE);
+
+        if (!state.allocator_block || !platform_commit_memory(state.allocator_block, state.allocator_block_size)) {
+            KFATAL("Memory system is unable to reserve %llu bytes.", config.total_alloc_size);
+            if (state.allocator_block)
+                platform_release_memory(state.allocator_block, state.allocator_block_size);
+            state.allocator_block = 0;
+            return FALSE;
+        }
+
+        if (config.use_large_pages)
+            platform_advise_memory(state.allocator_block, state.allocator_block_size, PLATFORM_MEMORY_ADVICE_HUGE_PAGES);
+
+        // Touch every page now so they are faulted in up front, rather than in the middle of a frame.
+        platform_zero_memory(state.allocator_block, state.allocator_block_size);
+    }
+
+    if (!dynamic_allocator_create(state.allocator_block_size, state.allocator_block, &state.allocator)) {
+        KFATAL("Memory system is unable to setup its internal allocator.");
+        platform_release_memory(state.allocator_block, state.allocator_block_size);
+        state.allocator_block = 0;
+        return FALSE;
+    }
+
+    KDEBUG("Memory system reserved %llu bytes.", config.total_alloc_size);
+    return TRUE;
 }
 
 void shutdown_memory()
 {
+#if KMEMORY_TRACKING_ENABLED
+    tracking_report(TRUE);
+    tracking_table_destroy(&state.allocations);
+    tracking_table_destroy(&state.callsites);
+#endif
+
+    if (state.allocator_block) {
+        dynamic_allocator_destroy(&state.allocator);
+        platform_release_memory(state.allocator_block, state.allocator_block_size);
+        state.allocator_block = 0;
+    }
+}
+
+// Allocates from the dynamic allocator under its lock, falling back to the heap when the reserved block is full.
+static void* shared_allocate(u64 size, u16 alignment)
+{
+    allocator_lock();
+    void* block = dynamic_allocator_allocate_aligned(&state.allocator, size, alignment);
+    if (block) {
+        allocator_unlock();
+        return block;
+    }
+
+    if (state.config.hard_limit && state.allocator_block) {
+        allocator_unlock();
+        KFATAL("kallocate - Out of memory. Unable to allocate %lluB within the configured limit.", size);
+        return 0;
+    }
+
+    b8 warn = state.allocator_block && !state.heap_fallback_warned;
+    state.heap_fallback_warned = TRUE;
+    state.heap_fallback_allocated += size;
+    allocator_unlock();
+
+    if (warn)
+        KWARN("kallocate - Reserved memory block exhausted, falling back to the heap. Consider a larger total_alloc_size.");
+
+    block = platform_allocate_aligned(size, alignment);
+    if (!block)
+        KFATAL("kallocate - The system is out of memory, unable to allocate %lluB.", size);
+    return block;
 }
 
 void* kallocate(u64 size, memory_tag tag)
+{
+    return kallocate_aligned(size, KMEMORY_DEFAULT_ALIGNMENT, tag);
+}
+
+void kfree(void* block, u64 size, memory_tag tag)
+{
+    kfree_aligned(block, size, KMEMORY_DEFAULT_ALIGNMENT, tag);
+}
+
+void* kallocate_aligned(u64 size, u16 alignment, memory_tag tag)
+{
+    return kallocate_tracked(size, alignment, tag, TRUE, 0, 0);
+}
+
+void* kallocate_uninitialized(u64 size, memory_tag tag)
+{
+    return kallocate_tracked(size, KMEMORY_DEFAULT_ALIGNMENT, tag, FALSE, 0, 0);
+}
+
+void* kallocate_aligned_uninitialized(u64 size, u16 alignment, memory_tag tag)
+{
+    return kallocate_tracked(size, alignment, tag, FALSE, 0, 0);
+}
+
+void* kallocate_tracked(u64 size, u16 alignment, memory_tag tag, b8 zero_memory, const char* file, u32 line)
 {
     if (tag == MEMORY_TAG_UNKNOWN)
         KWARN("kallocate called using MEMORY_TAG_UNKOWN. Re-class this allocation.");
 
-    stats.total_allocated += size;
-    stats.tagged_allocations[tag] += size;
+    if (alignment == 0 || (alignment & (alignment - 1)) || alignment > KMEMORY_MAX_ALIGNMENT) {
+        KERROR("kallocate_aligned - alignment must be a power of two no larger than %i, got %i.", KMEMORY_MAX_ALIGNMENT, alignment);
+        return 0;
+    }
+
+    if (alignment < KMEMORY_DEFAULT_ALIGNMENT)
+        alignment = KMEMORY_DEFAULT_ALIGNMENT;
+
+    budget_enforce(tag, size);
+
+    void* block = 0;
+    if (size <= THREAD_CACHE_MAX_SIZE && alignment == KMEMORY_DEFAULT_ALIGNMENT && state.allocator_block)
+        block = thread_cache_allocate(size);
+    if (!block)
+        block = shared_allocate(block_size_get(size), alignment);
+    if (!block)
+        return 0;
 
-    // TODO: memory alignment
-    void* block = platform_allocate(size, FALSE);
-    platform_zero_memory(block, size);
+    stats_record(tag, size, TRUE);
+
+#if KMEMORY_TRACKING_ENABLED
+    tracking_record_allocation(block, size, tag, file, line);
+#endif
+
+    if (zero_memory)
+        platform_zero_memory(block, size);
     return block;
 }
 
-void kfree(void* block, u64 size, memory_tag tag)
+void kfree_aligned(void* block, u64 size, u16 alignment, memory_tag tag)
 {
     if (tag == MEMORY_TAG_UNKNOWN)
-        KWARN("kallocate called using MEMORY_TAG_UNKOWN. Re-class this allocation.");
+        KWARN("kfree called using MEMORY_TAG_UNKOWN. Re-class this allocation.");
+
+    if (!block)
+        return;
+
+    stats_record(tag, size, FALSE);
+
+#if KMEMORY_TRACKING_ENABLED
+    tracking_record_free(block, size);
+#endif
+
+    // Blocks are handed back by address, so the alignment they were allocated with does not matter here.
+    if (size <= THREAD_CACHE_MAX_SIZE && dynamic_allocator_owns(&state.allocator, block)) {
+        thread_cache_free(block, size);
+        return;
+    }
+
+    u64 block_size = block_size_get(size);
+    allocator_lock();
+    if (dynamic_allocator_owns(&state.allocator, block)) {
+        dynamic_allocator_free(&state.allocator, block, block_size);
+        allocator_unlock();
+    } else {
+        state.heap_fallback_allocated -= block_size;
+        allocator_unlock();
+        platform_free_aligned(block);
+    }
+}
+
+void* kreallocate(void* block, u64 old_size, u64 new_size, memory_tag tag)
+{
+    return kreallocate_tracked(block, old_size, new_size, tag, 0, 0);
+}
+
+void* kreallocate_tracked(void* block, u64 old_size, u64 new_size, memory_tag tag, const char* file, u32 line)
+{
+    if (!block)
+        return kallocate_tracked(new_size, KMEMORY_DEFAULT_ALIGNMENT, tag, FALSE, file, line);
+
+    if (new_size > old_size)
+        budget_enforce(tag, new_size - old_size);
+
+    allocator_lock();
+    b8 resized = dynamic_allocator_resize(&state.allocator, block, block_size_get(old_size), block_size_get(new_size));
+    allocator_unlock();
+
+    if (resized) {
+        stats_record(tag, old_size, FALSE);
+        stats_record(tag, new_size, TRUE);
+#if KMEMORY_TRACKING_ENABLED
+        tracking_record_free(block, old_size);
+        tracking_record_allocation(block, new_size, tag, file, line);
+#endif
+        return block;
+    }
+
+    // Moving it is, then. Only the old contents are copied, the rest is left uninitialized.
+    void* moved = kallocate_tracked(new_size, KMEMORY_DEFAULT_ALIGNMENT, tag, FALSE, file, line);
+    if (!moved)
+        return 0;
+
+    kcopy_memory(moved, block, old_size < new_size ? old_size : new_size);
+    kfree(block, old_size, tag);
+    return moved;
+}
+
+u64 kmemory_page_size()
+{
+    return platform_page_size();
+}
 
-    stats.total_allocated -= size;
-    stats.tagged_allocations[tag] -= size;
+b8 kvirtual_reserve(u64 size, b8 large_pages, memory_tag tag, kvirtual_memory* out_memory)
+{
+    kzero_memory(out_memory, sizeof(kvirtual_memory));
+    out_memory->tag = tag;
+
+    if (large_pages) {
+        u64 large_page_size = platform_large_page_size();
+        if (large_page_size) {
+            u64 rounded = (size + large_page_size - 1) / large_page_size * large_page_size;
+            out_memory->base = platform_reserve_memory(rounded, TRUE);
+            if (out_memory->base) {
+                // Large page reservations come fully committed.
+                out_memory->reserved = rounded;
+                out_memory->committed = rounded;
+                out_memory->large_pages = TRUE;
+                stats_record(tag, rounded, TRUE);
+                return TRUE;
+            }
+        }
+        KDEBUG("kvirtual_reserve - large pages unavailable, using regular pages.");
+    }
+
+    u64 page_size = platform_page_size();
+    u64 rounded = (size + page_size - 1) / page_size * page_size;
+    out_memory->base = platform_reserve_memory(rounded, FALSE);
+    if (!out_memory->base) {
+        KERROR("kvirtual_reserve - unable to reserve %lluB of address space.", size);
+        return FALSE;
+    }
 
-    platform_free(block, FALSE);
+    out_memory->reserved = rounded;
+    if (large_pages)
+        platform_advise_memory(out_memory->base, rounded, PLATFORM_MEMORY_ADVICE_HUGE_PAGES);
+
+    return TRUE;
+}
+
+b8 kvirtual_commit(kvirtual_memory* memory, u64 size)
+{
+    if (size <= memory->committed)
+        return TRUE;
+
+    if (size > memory->reserved) {
+        KERROR("kvirtual_commit - %lluB requested, but only %lluB are reserved.", size, memory->reserved);
+        return FALSE;
+    }
+
+    u64 page_size = platform_page_size();
+    u64 rounded = (size + page_size - 1) / page_size * page_size;
+    if (rounded > memory->reserved)
+        rounded = memory->reserved;
+
+    // Commits are expected to fail now and then, so going over the budget only refuses this one.
+    u64 requested = budget_exceeded(memory->tag, rounded - memory->committed);
+    if (requested) {
+        __atomic_store_n(&state.tags[memory->tag].hard_exceeded_size, requested, __ATOMIC_RELAXED);
+        KERROR("kvirtual_commit - memory tag %s would exceed its hard budget of %lluB with %lluB, refusing the commit.",
+            memory_tag_strings[memory->tag], state.budgets[memory->tag].hard_budget, requested);
+        return FALSE;
+    }
+
+    if (!platform_commit_memory((u8*)memory->base + memory->committed, rounded - memory->committed)) {
+        KERROR("kvirtual_commit - unable to commit %lluB.", rounded - memory->committed);
+        return FALSE;
+    }
+
+    stats_record(memory->tag, rounded - memory->committed, TRUE);
+    memory->committed = rounded;
+    return TRUE;
+}
+
+void kvirtual_decommit(kvirtual_memory* memory, u64 keep_size)
+{
+    // Large pages stay locked in memory until released.
+    if (memory->large_pages || keep_size >= memory->committed)
+        return;
+
+    u64 page_size = platform_page_size();
+    u64 rounded = (keep_size + page_size - 1) / page_size * page_size;
+    if (rounded >= memory->committed)
+        return;
+
+    if (platform_decommit_memory((u8*)memory->base + rounded, memory->committed - rounded)) {
+        stats_record(memory->tag, memory->committed - rounded, FALSE);
+        memory->committed = rounded;
+    }
+}
+
+void kvirtual_release(kvirtual_memory* memory)
+{
+    if (!memory->base)
+        return;
+
+    if (memory->committed)
+        stats_record(memory->tag, memory->committed, FALSE);
+    platform_release_memory(memory->base, memory->reserved);
+    kzero_memory(memory, sizeof(kvirtual_memory));
+}
+
+void kvirtual_advise(kvirtual_memory* memory, u64 offset, u64 size, kmemory_advice advice)
+{
+    static const platform_memory_advice platform_advice[] = {
+        [KMEMORY_ADVICE_WILL_NEED] = PLATFORM_MEMORY_ADVICE_WILL_NEED,
+        [KMEMORY_ADVICE_DONT_NEED] = PLATFORM_MEMORY_ADVICE_DONT_NEED,
+        [KMEMORY_ADVICE_HUGE_PAGES] = PLATFORM_MEMORY_ADVICE_HUGE_PAGES,
+    };
+
+    if (offset + size > memory->committed) {
+        KWARN("kvirtual_advise - range extends past the committed memory, ignoring.");
+        return;
+    }
+
+    platform_advise_memory((u8*)memory->base + offset, size, platform_advice[advice]);
 }
 
 void* kzero_memory(void* block, u64 size)
@@ -78,45 +1078,230 @@ void* kcopy_memory(void* dest, const void* source, u64 size)
     return platform_copy_memory(dest, source, size);
 }
 
+void* kmove_memory(void* dest, const void* source, u64 size)
+{
+    return platform_move_memory(dest, source, size);
+}
+
 void* kset_memory(void* dest, i32 value, u64 size)
 {
     return platform_set_memory(dest, value, size);
 }
 
-char* get_memory_usage_str()
+void kmemory_report_allocations()
 {
-    const u64 kib = 1024;
-    const u64 mib = kib * 1024;
-    const u64 gib = mib * 1024;
+#if KMEMORY_TRACKING_ENABLED
+    tracking_report(FALSE);
+#else
+    KWARN("kmemory_report_allocations - allocation tracking is disabled. Build with KMEMORY_TRACKING_ENABLED=1.");
+#endif
+}
 
-    char buffer[8000] = "System memory use (tagged): \n";
-    u64 offset = strlen(buffer);
+void kmemory_set_tag_budget(memory_tag tag, u64 soft_budget, u64 hard_budget)
+{
+    if (tag >= MEMORY_TAG_MAX_TAGS) {
+        KERROR("kmemory_set_tag_budget - invalid tag %u.", tag);
+        return;
+    }
 
-    for (u32 i = 0; i < MEMORY_TAG_MAX_TAGS; ++i) {
-        char unit[4] = "XiB";
-        float amount = 1.0f;
+    if (soft_budget && hard_budget && soft_budget > hard_budget)
+        KWARN("kmemory_set_tag_budget - soft budget of %s is above its hard budget, it will never be reported.", memory_tag_strings[tag]);
 
-        if (stats.tagged_allocations[i] >= gib) {
-            unit[0] = 'G';
-            amount = stats.tagged_allocations[i] / (float)gib;
+    memory_tag_state* tag_state = &state.tags[tag];
+    tag_state->soft_budget = soft_budget;
+    tag_state->soft_exceeded = FALSE;
 
-        } else if (stats.tagged_allocations[i] >= mib) {
-            unit[0] = 'M';
-            amount = stats.tagged_allocations[i] / (float)mib;
+    // Usage is only kept while there is a hard budget, so it has to be caught up when one is set.
+    memory_tag_budget* budget = &state.budgets[tag];
+    if (hard_budget && !__atomic_load_n(&budget->hard_budget, __ATOMIC_RELAXED))
+        __atomic_store_n(&budget->allocated, stats_tag_allocated(tag), __ATOMIC_RELAXED);
+    __atomic_store_n(&budget->hard_budget, hard_budget, __ATOMIC_RELEASE);
+}
 
-        } else if (stats.tagged_allocations[i] >= kib) {
-            unit[0] = 'K';
-            amount = stats.tagged_allocations[i] / (float)kib;
+static void tag_stats_fill(memory_tag tag, const memory_stats* stats, memory_tag_stats* out_stats)
+{
+    const memory_tag_counters* counters = &stats->tags[tag];
+    const memory_tag_state* tag_state = &state.tags[tag];
+    tag_peak_sample(tag, counters->allocated);
+    out_stats->allocated = counters->allocated;
+    out_stats->peak_allocated = __atomic_load_n(&tag_state->peak_allocated, __ATOMIC_RELAXED);
+    out_stats->allocation_count = counters->allocation_count;
+    out_stats->free_count = counters->free_count;
+    out_stats->frame_allocated = tag_state->frame_delta.allocated_total;
+    out_stats->frame_freed = tag_state->frame_freed;
+    out_stats->frame_allocation_count = tag_state->frame_delta.allocation_count;
+    out_stats->frame_free_count = tag_state->frame_delta.free_count;
+    out_stats->soft_budget = tag_state->soft_budget;
+    out_stats->hard_budget = __atomic_load_n(&state.budgets[tag].hard_budget, __ATOMIC_RELAXED);
+}
 
-        } else {
-            unit[0] = 'B';
-            unit[1] = 0;
-            amount = (float)stats.tagged_allocations[i];
+b8 kmemory_get_tag_stats(memory_tag tag, memory_tag_stats* out_stats)
+{
+    if (tag >= MEMORY_TAG_MAX_TAGS || !out_stats)
+        return FALSE;
+
+    memory_stats stats;
+    stats_aggregate(&stats);
+    tag_stats_fill(tag, &stats, out_stats);
+    return TRUE;
+}
+
+void kmemory_get_snapshot(memory_snapshot* out_snapshot)
+{
+    memory_stats stats;
+    stats_aggregate(&stats);
+
+    out_snapshot->total_allocated = stats.total_allocated;
+    out_snapshot->reserved_size = state.allocator_block_size;
+
+    allocator_lock();
+    out_snapshot->reserved_free = dynamic_allocator_free_space(&state.allocator);
+    out_snapshot->heap_fallback_allocated = state.heap_fallback_allocated;
+    allocator_unlock();
+
+    for (u32 tag = 0; tag < MEMORY_TAG_MAX_TAGS; ++tag)
+        tag_stats_fill(tag, &stats, &out_snapshot->tags[tag]);
+}
+
+const char* kmemory_tag_name(memory_tag tag)
+{
+    return tag < MEMORY_TAG_MAX_TAGS ? memory_tag_strings[tag] : "INVALID    ";
+}
+
+void kmemory_frame_end()
+{
+    memory_stats stats;
+    stats_aggregate(&stats);
+
+    for (u32 tag = 0; tag < MEMORY_TAG_MAX_TAGS; ++tag) {
+        const memory_tag_counters* counters = &stats.tags[tag];
+        memory_tag_state* tag_state = &state.tags[tag];
+
+        // Bytes freed are derived rather than counted, see memory_tag_counters.
+        u64 freed_total = counters->allocated_total - counters->allocated;
+        u64 frame_start_freed_total = tag_state->frame_start.allocated_total - tag_state->frame_start.allocated;
+
+        tag_state->frame_delta.allocated_total = counters->allocated_total - tag_state->frame_start.allocated_total;
+        tag_state->frame_delta.allocation_count = counters->allocation_count - tag_state->frame_start.allocation_count;
+        tag_state->frame_delta.free_count = counters->free_count - tag_state->frame_start.free_count;
+        tag_state->frame_freed = freed_total - frame_start_freed_total;
+        tag_state->frame_start = *counters;
+        tag_peak_sample(tag, counters->allocated);
+
+        if (tag_state->soft_budget) {
+            b8 exceeded = counters->allocated > tag_state->soft_budget;
+            if (exceeded && !tag_state->soft_exceeded) {
+                KWARN("Memory tag %s exceeded its soft budget of %lluB with %lluB.", memory_tag_strings[tag], tag_state->soft_budget, counters->allocated);
+                budget_event_fire(EVENT_CODE_MEMORY_SOFT_BUDGET_EXCEEDED, tag, counters->allocated);
+            }
+            tag_state->soft_exceeded = exceeded;
+        }
+
+        u64 hard_exceeded_size = __atomic_exchange_n(&tag_state->hard_exceeded_size, 0, __ATOMIC_RELAXED);
+        if (hard_exceeded_size)
+            budget_event_fire(EVENT_CODE_MEMORY_HARD_BUDGET_EXCEEDED, tag, hard_exceeded_size);
+    }
+}
+
+// Appends a byte count with a binary unit.
+static void report_append_size(string_builder* line, u64 bytes)
+{
+    static const char* units[] = { " B", " KiB", " MiB", " GiB", " TiB" };
+
+    u32 unit = 0;
+    u64 scale = 1;
+    while (unit < 4 && bytes >= scale * 1024) {
+        scale *= 1024;
+        unit++;
+    }
+
+    if (unit == 0)
+        string_builder_append_u64(line, bytes);
+    else
+        string_builder_append_f64(line, (f64)bytes / (f64)scale, 2);
+    string_builder_append(line, units[unit]);
+}
+
+void kmemory_report_stream(const memory_snapshot* snapshot, PFN_memory_report_sink sink, void* user_data)
+{
+    // Every line is built on the stack and handed straight to the sink.
+    char buffer[256];
+    string_builder line;
+    string_builder_create(buffer, sizeof(buffer), &line);
+
+    string_builder_append(&line, "System memory use (tagged):\n");
+    sink(line.buffer, line.length, user_data);
+
+    for (u32 tag = 0; tag < MEMORY_TAG_MAX_TAGS; ++tag) {
+        const memory_tag_stats* stats = &snapshot->tags[tag];
+
+        string_builder_reset(&line);
+        string_builder_append(&line, "  ");
+        string_builder_append(&line, memory_tag_strings[tag]);
+        string_builder_append(&line, ": ");
+        report_append_size(&line, stats->allocated);
+        string_builder_append(&line, " (peak ");
+        report_append_size(&line, stats->peak_allocated);
+        string_builder_append(&line, ", ");
+        string_builder_append_u64(&line, stats->allocation_count);
+        string_builder_append(&line, " allocs, ");
+        string_builder_append_u64(&line, stats->free_count);
+        string_builder_append(&line, " frees, frame +");
+        report_append_size(&line, stats->frame_allocated);
+        string_builder_append(&line, "/-");
+        report_append_size(&line, stats->frame_freed);
+        string_builder_append_char(&line, ')');
+
+        if (stats->hard_budget) {
+            string_builder_append(&line, " [hard budget ");
+            report_append_size(&line, stats->hard_budget);
+            string_builder_append_char(&line, ']');
+        } else if (stats->soft_budget) {
+            string_builder_append(&line, " [soft budget ");
+            report_append_size(&line, stats->soft_budget);
+            string_builder_append_char(&line, ']');
         }
 
-        i32 length = snprintf(buffer + offset, 8000, "  %s: %.2f %s\n", memory_tag_strings[i], amount, unit);
-        offset += length;
+        string_builder_append_char(&line, '\n');
+        sink(line.buffer, line.length, user_data);
     }
-    char* out_string = _strdup(buffer);
-    return out_string;
-}
\ No newline at end of file
+
+    string_builder_reset(&line);
+    string_builder_append(&line, "  Total: ");
+    report_append_size(&line, snapshot->total_allocated);
+    string_builder_append(&line, ", reserved block ");
+    report_append_size(&line, snapshot->reserved_size - snapshot->reserved_free);
+    string_builder_append(&line, " of ");
+    report_append_size(&line, snapshot->reserved_size);
+    string_builder_append(&line, " in use, heap fallback ");
+    report_append_size(&line, snapshot->heap_fallback_allocated);
+    string_builder_append_char(&line, '\n');
+    sink(line.buffer, line.length, user_data);
+}
+
+typedef struct report_buffer {
+    char* data;
+    u64 size;
+    u64 length;
+} report_buffer;
+
+static void report_buffer_sink(const char* text, u64 length, void* user_data)
+{
+    report_buffer* buffer = user_data;
+    if (buffer->size && buffer->length < buffer->size - 1) {
+        u64 available = buffer->size - 1 - buffer->length;
+        platform_copy_memory(buffer->data + buffer->length, text, length < available ? length : available);
+    }
+    // Keep counting past the end, so the caller learns how much room the full report needs.
+    buffer->length += length;
+}
+
+u64 kmemory_report_write(const memory_snapshot* snapshot, char* buffer, u64 buffer_size)
+{
+    report_buffer out = { buffer, buffer_size, 0 };
+    kmemory_report_stream(snapshot, report_buffer_sink, &out);
+
+    if (buffer_size)
+        buffer[out.length < buffer_size ? out.length : buffer_size - 1] = 0;
+    return out.length;
+}
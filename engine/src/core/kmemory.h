@@ -2,6 +2,16 @@
 
 #include "defines.h"
 
+/**
+ * Allocation tracking. When the engine is built with KMEMORY_TRACKING_ENABLED set to 1, every
+ * live allocation is recorded along with its callsite, leaks and the heaviest callsites are
+ * reported at shutdown_memory, and kmemory_report_allocations can be called at any time.
+ * Off by default, in which case it costs nothing.
+ */
+#ifndef KMEMORY_TRACKING_ENABLED
+#define KMEMORY_TRACKING_ENABLED 0
+#endif
+
 typedef enum memory_tag {
     MEMORY_TAG_UNKNOWN,
     MEMORY_TAG_ARRAY,
@@ -20,18 +30,253 @@ typedef enum memory_tag {
     MEMORY_TAG_ENTITY,
     MEMORY_TAG_ENTITY_NODE,
     MEMORY_TAG_SCENE,
+    MEMORY_TAG_LINEAR_ALLOCATOR,
 
     MEMORY_TAG_MAX_TAGS,
 } memory_tag;
 
-KAPI void initialize_memory();
+typedef struct memory_system_configuration {
+    // The total size in bytes reserved up front and served by the internal allocator.
+    u64 total_alloc_size;
+
+    // If TRUE, allocations that do not fit in the reserved block fail instead of falling
+    // back to the system heap, putting a hard ceiling on the memory the engine uses.
+    b8 hard_limit;
+
+    // If TRUE, the reserved block is backed by large pages when the platform allows it,
+    // cutting TLB misses across the whole engine heap.
+    b8 use_large_pages;
+} memory_system_configuration;
+
+KAPI b8 initialize_memory(memory_system_configuration config);
 KAPI void shutdown_memory();
 
+// Every block returned by kallocate is aligned to at least this many bytes.
+#define KMEMORY_DEFAULT_ALIGNMENT 16
+
+// The largest alignment that may be requested from kallocate_aligned. One page.
+#define KMEMORY_MAX_ALIGNMENT 4096
+
 KAPI void* kallocate(u64 size, memory_tag tag);
 KAPI void kfree(void* block, u64 size, memory_tag tag);
 
+/**
+ * Allocates a zeroed block of memory aligned to the given alignment.
+ * @param size The size in bytes to be allocated.
+ * @param alignment The required alignment in bytes. Must be a power of two no larger than KMEMORY_MAX_ALIGNMENT.
+ * @param tag The tag the allocation is accounted under.
+ * @returns A pointer to the allocated block, or 0/NULL on failure.
+ */
+KAPI void* kallocate_aligned(u64 size, u16 alignment, memory_tag tag);
+
+/**
+ * Frees a block allocated with kallocate_aligned.
+ * @param block The block to be freed.
+ * @param size The size in bytes the block was allocated with.
+ * @param alignment The alignment the block was allocated with.
+ * @param tag The tag the block was allocated with.
+ */
+KAPI void kfree_aligned(void* block, u64 size, u16 alignment, memory_tag tag);
+
+/**
+ * Allocates a block of memory WITHOUT zeroing it. Use when the caller overwrites the whole
+ * block anyway, to avoid paying for zeroing it first. Freed with kfree as usual.
+ * @param size The size in bytes to be allocated.
+ * @param tag The tag the allocation is accounted under.
+ * @returns A pointer to the allocated, uninitialized block, or 0/NULL on failure.
+ */
+KAPI void* kallocate_uninitialized(u64 size, memory_tag tag);
+
+// Aligned variant of kallocate_uninitialized. Freed with kfree_aligned.
+KAPI void* kallocate_aligned_uninitialized(u64 size, u16 alignment, memory_tag tag);
+
+/**
+ * Allocates like kallocate_aligned, zeroing the block only if requested and recording the given
+ * callsite when allocation tracking is enabled. Normally reached through the kallocate macros
+ * rather than directly.
+ */
+KAPI void* kallocate_tracked(u64 size, u16 alignment, memory_tag tag, b8 zero_memory, const char* file, u32 line);
+
+/**
+ * Resizes a block allocated with kallocate or kallocate_uninitialized, in place when the memory
+ * right behind it is free, so growth does not need room for both the old and the new block.
+ * Otherwise the contents are moved to a new block. Bytes past old_size are NOT zeroed.
+ * @param block The block to be resized. If 0/NULL, this acts like kallocate_uninitialized.
+ * @param old_size The size in bytes the block currently has.
+ * @param new_size The size in bytes the block should have.
+ * @param tag The tag the block was allocated with.
+ * @returns A pointer to the resized block, which may have moved, or 0/NULL on failure, in which case the original block is untouched.
+ */
+KAPI void* kreallocate(void* block, u64 old_size, u64 new_size, memory_tag tag);
+
+// kreallocate, recording the given callsite when allocation tracking is enabled.
+KAPI void* kreallocate_tracked(void* block, u64 old_size, u64 new_size, memory_tag tag, const char* file, u32 line);
+
+/**
+ * Returns the blocks cached by the calling thread to the shared allocator. Each thread keeps its own
+ * cache of recently freed blocks up to 2KiB, so that allocating them rarely contends on a lock. Threads
+ * other than the main thread should call this before they exit, or their cached blocks stay unusable
+ * until shutdown.
+ */
+KAPI void kmemory_thread_cache_flush();
+
+// Logs the live allocations and heaviest callsites. Does nothing useful unless tracking is enabled.
+KAPI void kmemory_report_allocations();
+
+/**
+ * Virtual memory. A range of address space is reserved once and committed from its start as it
+ * is needed, so whatever lives in it can grow in place without being moved or copied. Committed
+ * bytes are accounted under the memory's tag.
+ */
+typedef struct kvirtual_memory {
+    void* base;
+    u64 reserved;
+    u64 committed;
+    memory_tag tag;
+    b8 large_pages;
+} kvirtual_memory;
+
+typedef enum kmemory_advice {
+    // The range is about to be accessed, start paging it in.
+    KMEMORY_ADVICE_WILL_NEED,
+    // The contents of the range are no longer needed, but it stays committed.
+    KMEMORY_ADVICE_DONT_NEED,
+    // Back the range with huge pages where the OS supports doing so transparently.
+    KMEMORY_ADVICE_HUGE_PAGES,
+} kmemory_advice;
+
+// The size of a regular page in bytes.
+KAPI u64 kmemory_page_size();
+
+/**
+ * Reserves address space.
+ * @param size The size in bytes to reserve. Rounded up to whole pages.
+ * @param large_pages If TRUE, tries to back the range with large pages. Such a range is committed
+ * in full up front. If large pages are unavailable, regular pages are used instead.
+ * @param tag The tag committed memory is accounted under.
+ * @param out_memory A pointer to hold the reservation.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 kvirtual_reserve(u64 size, b8 large_pages, memory_tag tag, kvirtual_memory* out_memory);
+
+// Makes sure at least the first size bytes of the reservation are committed. Fresh memory reads as zero.
+KAPI b8 kvirtual_commit(kvirtual_memory* memory, u64 size);
+
+// Decommits everything past the first keep_size bytes (rounded up to a page), keeping the address space.
+KAPI void kvirtual_decommit(kvirtual_memory* memory, u64 keep_size);
+
+// Releases the whole reservation.
+KAPI void kvirtual_release(kvirtual_memory* memory);
+
+// Gives the OS a hint about how a committed range, relative to the base, is going to be used.
+KAPI void kvirtual_advise(kvirtual_memory* memory, u64 offset, u64 size, kmemory_advice advice);
+
+/**
+ * A point in time view of a single tag. The frame_ fields cover the last completed frame. Peaks are
+ * sampled at the end of every frame and whenever stats are read, not on every allocation, which
+ * would mean summing every thread's counters each time. A spike that comes and goes between two
+ * samples is not seen.
+ */
+typedef struct memory_tag_stats {
+    // Bytes currently allocated.
+    u64 allocated;
+    // The most bytes seen allocated at once, by the samples taken so far.
+    u64 peak_allocated;
+    // Allocations and frees made since startup.
+    u64 allocation_count;
+    u64 free_count;
+
+    u64 frame_allocated;
+    u64 frame_freed;
+    u64 frame_allocation_count;
+    u64 frame_free_count;
+
+    // The configured budgets, 0 when not set.
+    u64 soft_budget;
+    u64 hard_budget;
+} memory_tag_stats;
+
+/**
+ * Sets the budgets of a tag. Crossing the soft budget fires EVENT_CODE_MEMORY_SOFT_BUDGET_EXCEEDED at
+ * the end of the frame it happened in. An allocation that would take the tag past its hard budget
+ * logs a fatal error and aborts on the spot. A kvirtual_commit that would do so is refused instead,
+ * and EVENT_CODE_MEMORY_HARD_BUDGET_EXCEEDED is fired at the end of the frame. A tag with a hard budget
+ * costs an atomic add on every allocation and free under it. Set hard budgets before other threads
+ * allocate under the tag, as the usage they are checked against is caught up when they are set.
+ * @param tag The tag to budget.
+ * @param soft_budget The soft budget in bytes. 0 for none.
+ * @param hard_budget The hard budget in bytes. 0 for none.
+ */
+KAPI void kmemory_set_tag_budget(memory_tag tag, u64 soft_budget, u64 hard_budget);
+
+/**
+ * Gets the current stats of a tag.
+ * @param tag The tag to query.
+ * @param out_stats A pointer to hold the stats.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 kmemory_get_tag_stats(memory_tag tag, memory_tag_stats* out_stats);
+
+// Samples peaks and per-frame deltas, and raises budget events. Called by the application at the end of every frame.
+void kmemory_frame_end();
+
 KAPI void* kzero_memory(void* block, u64 size);
 KAPI void* kcopy_memory(void* dest, const void* source, u64 size);
+// Copies memory between ranges that may overlap.
+KAPI void* kmove_memory(void* dest, const void* source, u64 size);
 KAPI void* kset_memory(void* dest, i32 value, u64 size);
 
-KAPI char* get_memory_usage_str();
+// Everything the memory system knows at a point in time.
+typedef struct memory_snapshot {
+    // Bytes currently allocated across all tags.
+    u64 total_allocated;
+    // The size of the block reserved at initialization, and how much of it is free. Blocks held in
+    // per-thread caches count as in use.
+    u64 reserved_size;
+    u64 reserved_free;
+    // Bytes currently allocated from the heap because the reserved block was full.
+    u64 heap_fallback_allocated;
+
+    memory_tag_stats tags[MEMORY_TAG_MAX_TAGS];
+} memory_snapshot;
+
+/**
+ * Takes a snapshot of the memory system. Allocates nothing, so it is safe to call every frame.
+ * @param out_snapshot A pointer to hold the snapshot.
+ */
+KAPI void kmemory_get_snapshot(memory_snapshot* out_snapshot);
+
+// The display name of a tag, padded to a fixed width.
+KAPI const char* kmemory_tag_name(memory_tag tag);
+
+/**
+ * Receives a memory report piece by piece. The text is not null terminated and is only valid
+ * for the duration of the call.
+ */
+typedef void (*PFN_memory_report_sink)(const char* text, u64 length, void* user_data);
+
+/**
+ * Formats a snapshot as a human readable report, one line at a time, without allocating.
+ * @param snapshot The snapshot to report.
+ * @param sink The function every line is handed to.
+ * @param user_data Passed through to the sink. Can be 0/NULL.
+ */
+KAPI void kmemory_report_stream(const memory_snapshot* snapshot, PFN_memory_report_sink sink, void* user_data);
+
+/**
+ * Formats a snapshot as a human readable report into a caller provided buffer, without allocating.
+ * The output is always null terminated, and truncated if the buffer is too small.
+ * @param snapshot The snapshot to report.
+ * @param buffer The buffer to write to.
+ * @param buffer_size The size of the buffer in bytes, including room for the terminator.
+ * @returns The length of the full report, not counting the terminator. If this is not less than buffer_size, the report was truncated.
+ */
+KAPI u64 kmemory_report_write(const memory_snapshot* snapshot, char* buffer, u64 buffer_size);
+
+#if KMEMORY_TRACKING_ENABLED
+#define kallocate(size, tag) kallocate_tracked(size, KMEMORY_DEFAULT_ALIGNMENT, tag, TRUE, __FILE__, __LINE__)
+#define kallocate_aligned(size, alignment, tag) kallocate_tracked(size, alignment, tag, TRUE, __FILE__, __LINE__)
+#define kallocate_uninitialized(size, tag) kallocate_tracked(size, KMEMORY_DEFAULT_ALIGNMENT, tag, FALSE, __FILE__, __LINE__)
+#define kallocate_aligned_uninitialized(size, alignment, tag) kallocate_tracked(size, alignment, tag, FALSE, __FILE__, __LINE__)
+#define kreallocate(block, old_size, new_size, tag) kreallocate_tracked(block, old_size, new_size, tag, __FILE__, __LINE__)
+#endif
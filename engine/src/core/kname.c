@@ -0,0 +1,90 @@
+#include "kname.h"
+
+#include "containers/hashtable.h"
+#include "core/kmemory.h"
+#include "core/kstring.h"
+#include "core/linear_allocator.h"
+#include "core/logger.h"
+
+typedef struct kname_state {
+    // Every interned string, back to back. Grows in place, so the strings never move.
+    linear_allocator arena;
+    // Maps each name to its string in the arena.
+    hashtable strings;
+} kname_state;
+
+static b8 initialized = FALSE;
+static kname_state state;
+
+// Names are already well mixed hashes, so they serve as their own table hash.
+static u64 kname_table_hash(const void* key, u64 size)
+{
+    return *(const kname*)key;
+}
+
+b8 kname_initialize()
+{
+    if (!linear_allocator_create_virtual(KNAME_ARENA_SIZE, FALSE, &state.arena)) {
+        KERROR("kname_initialize - failed to reserve the string arena.");
+        return FALSE;
+    }
+
+    if (!hashtable_create(sizeof(kname), 0, 1024, TRUE, kname_table_hash, &state.strings)) {
+        KERROR("kname_initialize - failed to create the name table.");
+        linear_allocator_destroy(&state.arena);
+        return FALSE;
+    }
+
+    initialized = TRUE;
+    return TRUE;
+}
+
+void kname_shutdown()
+{
+    if (!initialized)
+        return;
+
+    hashtable_destroy(&state.strings);
+    linear_allocator_destroy(&state.arena);
+    initialized = FALSE;
+}
+
+kname kname_create(const char* str)
+{
+    if (!str)
+        return INVALID_KNAME;
+
+    u64 length = string_length(str);
+    kname name = kname_hash(str, length);
+    if (name == INVALID_KNAME || !initialized)
+        return name;
+
+    char* interned;
+    if (hashtable_get_ptr(&state.strings, &name, (void**)&interned)) {
+        // Two strings sharing a 64-bit hash is vanishingly unlikely, but handing out the same name
+        // for both would make them compare equal.
+        if (!strings_equal(interned, str)) {
+            KERROR("kname_create - '%s' and '%s' share the name %llu, '%s' is not interned.", interned, str, name, str);
+            return INVALID_KNAME;
+        }
+        return name;
+    }
+
+    interned = linear_allocator_allocate(&state.arena, length + 1);
+    if (!interned) {
+        KERROR("kname_create - the name table is out of space, '%s' is not interned.", str);
+        return name;
+    }
+
+    kcopy_memory(interned, str, length + 1);
+    hashtable_set_ptr(&state.strings, &name, interned);
+    return name;
+}
+
+const char* kname_string_get(kname name)
+{
+    char* interned = 0;
+    if (initialized && name != INVALID_KNAME)
+        hashtable_get_ptr(&state.strings, &name, (void**)&interned);
+    return interned;
+}
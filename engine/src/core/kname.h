@@ -0,0 +1,65 @@
+#pragma once
+
+#include "defines.h"
+
+/**
+ * An interned string, identified by the 64-bit FNV-1a hash of its characters. Names returned by
+ * kname_create compare equal exactly when their strings do, so comparing two names costs one
+ * integer compare instead of a strcmp. A string whose hash is already taken by a different string
+ * is refused rather than given the same name.
+ */
+typedef u64 kname;
+
+// The name of the empty string, and of no string at all.
+#define INVALID_KNAME 0
+
+#define KNAME_FNV_OFFSET_BASIS 0xCBF29CE484222325ULL
+#define KNAME_FNV_PRIME 0x100000001B3ULL
+
+// The most string data the name table can hold. Only what is used gets committed.
+#define KNAME_ARENA_SIZE MEBIBYTES(16)
+
+b8 kname_initialize();
+void kname_shutdown();
+
+/**
+ * Computes the name of a string without interning it. Can be used to compare against interned
+ * names, but kname_string_get only knows the strings passed to kname_create.
+ * @param str The string.
+ * @param length The length of the string, not counting the terminator.
+ * @returns The name.
+ */
+static inline kname kname_hash(const char* str, u64 length)
+{
+    if (length == 0)
+        return INVALID_KNAME;
+
+    u64 hash = KNAME_FNV_OFFSET_BASIS;
+    for (u64 i = 0; i < length; ++i) {
+        hash ^= (u8)str[i];
+        hash *= KNAME_FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * The name of a string literal. With optimizations on, the compiler usually folds the hash to a
+ * constant. It is still not a constant expression, so it cannot be a case label; compare names
+ * with == instead of switching over them.
+ */
+#define KNAME(literal) kname_hash("" literal, sizeof(literal) - 1)
+
+/**
+ * Interns a string, copying it into the name table if it is not there yet.
+ * @param str The string. May be 0/NULL.
+ * @returns The string's name, or INVALID_KNAME for an empty or 0/NULL string, or one whose hash
+ * already names a different string.
+ */
+KAPI kname kname_create(const char* str);
+
+/**
+ * Gets the interned string of a name.
+ * @param name The name.
+ * @returns The string, which stays valid until shutdown, or 0/NULL if it was never interned.
+ */
+KAPI const char* kname_string_get(kname name);
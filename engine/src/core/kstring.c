@@ -1,23 +1,370 @@
 #include "kstring.h"
 
 #include "core/kmemory.h"
+#include "core/linear_allocator.h"
 
+#include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
 
-u64 string_length(const char* str)
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define KSTRING_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// The scans below may read past the end of a string, but never past the end of the page it ends
+// in, which is always safe. Address sanitizers cannot tell the difference.
+#if defined(__clang__) || defined(__GNUC__)
+#define KSTRING_NO_SANITIZE __attribute__((no_sanitize_address))
+#else
+#define KSTRING_NO_SANITIZE
+#endif
+
+// The smallest page size of any supported platform.
+#define KSTRING_PAGE_SIZE 4096
+
+KSTRING_NO_SANITIZE u64 string_length(const char* str)
 {
+#if KSTRING_SSE2
+    // Aligned loads cannot cross a page boundary, so start at the block holding the first character
+    // and ignore whatever comes before it.
+    const char* block = (const char*)((u64)str & ~15ULL);
+    __m128i zero = _mm_setzero_si128();
+    u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*)block), zero)) >> ((u64)str & 15);
+    if (mask)
+        return __builtin_ctz(mask);
+
+    for (;;) {
+        block += 16;
+        mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*)block), zero));
+        if (mask)
+            return (u64)(block - str) + __builtin_ctz(mask);
+    }
+#else
     return strlen(str);
+#endif
 }
 
 char* string_duplicate(const char* str)
 {
     u64 length = string_length(str);
-    char* copy = kallocate(length + 1, MEMORY_TAG_STRING);
+    char* copy = kallocate_uninitialized(length + 1, MEMORY_TAG_STRING);
     kcopy_memory(copy, str, length + 1);
     return copy;
 }
 
-b8 strings_equal(const char* str0, const char* str1)
+KSTRING_NO_SANITIZE b8 strings_equal(const char* str0, const char* str1)
 {
+#if KSTRING_SSE2
+    __m128i zero = _mm_setzero_si128();
+    for (;;) {
+        // Compare a block at a time while neither block reaches into the next page, and a
+        // character at a time across the boundary.
+        if (((u64)str0 & (KSTRING_PAGE_SIZE - 1)) <= KSTRING_PAGE_SIZE - 16 && ((u64)str1 & (KSTRING_PAGE_SIZE - 1)) <= KSTRING_PAGE_SIZE - 16) {
+            __m128i a = _mm_loadu_si128((const __m128i*)str0);
+            __m128i b = _mm_loadu_si128((const __m128i*)str1);
+            u32 differs = ~(u32)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & 0xFFFF;
+            u32 ends = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(a, zero));
+            u32 stop = differs | ends;
+            if (stop) {
+                // Either the first difference, or the end of both strings.
+                u32 index = __builtin_ctz(stop);
+                return str0[index] == str1[index];
+            }
+            str0 += 16;
+            str1 += 16;
+        } else {
+            if (*str0 != *str1)
+                return FALSE;
+            if (!*str0)
+                return TRUE;
+            str0++;
+            str1++;
+        }
+    }
+#else
     return strcmp(str0, str1) == 0;
+#endif
+}
+
+i64 string_find(const char* haystack, const char* needle)
+{
+    return string_view_find(string_view_create(haystack), string_view_create(needle));
+}
+
+string_view string_view_create(const char* str)
+{
+    string_view view = { str, str ? string_length(str) : 0 };
+    return view;
+}
+
+b8 string_view_equal(string_view a, string_view b)
+{
+    return a.length == b.length && memcmp(a.str, b.str, a.length) == 0;
+}
+
+i64 string_view_find(string_view haystack, string_view needle)
+{
+    if (needle.length == 0)
+        return 0;
+    if (needle.length > haystack.length)
+        return -1;
+
+    // The last position the needle could start at.
+    u64 last = haystack.length - needle.length;
+    u64 i = 0;
+
+#if KSTRING_SSE2
+    // Look for 16 positions at a time that both start with the needle's first character and have
+    // its last character in the right place, and only compare the whole needle at those.
+    __m128i first = _mm_set1_epi8(needle.str[0]);
+    __m128i final = _mm_set1_epi8(needle.str[needle.length - 1]);
+    for (; i + 16 <= last + 1; i += 16) {
+        __m128i starts = _mm_loadu_si128((const __m128i*)(haystack.str + i));
+        __m128i ends = _mm_loadu_si128((const __m128i*)(haystack.str + i + needle.length - 1));
+        u32 candidates = (u32)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(starts, first), _mm_cmpeq_epi8(ends, final)));
+        for (; candidates; candidates &= candidates - 1) {
+            u64 position = i + __builtin_ctz(candidates);
+            if (memcmp(haystack.str + position, needle.str, needle.length) == 0)
+                return (i64)position;
+        }
+    }
+#endif
+
+    for (; i <= last; ++i) {
+        if (haystack.str[i] == needle.str[0] && memcmp(haystack.str + i, needle.str, needle.length) == 0)
+            return (i64)i;
+    }
+    return -1;
+}
+
+string_view string_view_substring(string_view view, u64 start, u64 length)
+{
+    if (start > view.length)
+        start = view.length;
+    if (length > view.length - start)
+        length = view.length - start;
+
+    string_view result = { view.str + start, length };
+    return result;
+}
+
+b8 string_view_starts_with(string_view view, string_view prefix)
+{
+    return prefix.length <= view.length && memcmp(view.str, prefix.str, prefix.length) == 0;
+}
+
+b8 string_view_ends_with(string_view view, string_view suffix)
+{
+    return suffix.length <= view.length && memcmp(view.str + view.length - suffix.length, suffix.str, suffix.length) == 0;
+}
+
+void string_builder_create(char* buffer, u64 size, string_builder* out_builder)
+{
+    out_builder->buffer = buffer;
+    out_builder->length = 0;
+    out_builder->capacity = size;
+    out_builder->arena = 0;
+    out_builder->truncated = FALSE;
+    buffer[0] = 0;
+}
+
+static u64 align16(u64 value)
+{
+    return (value + 15) & ~15ULL;
+}
+
+b8 string_builder_create_arena(linear_allocator* arena, u64 capacity, string_builder* out_builder)
+{
+    capacity = align16(capacity + 1);
+    char* buffer = linear_allocator_allocate(arena, capacity);
+    if (!buffer)
+        return FALSE;
+
+    string_builder_create(buffer, capacity, out_builder);
+    out_builder->arena = arena;
+    return TRUE;
+}
+
+void string_builder_reset(string_builder* builder)
+{
+    builder->length = 0;
+    builder->truncated = FALSE;
+    builder->buffer[0] = 0;
+}
+
+// Makes room for count more characters. Returns FALSE if the builder cannot grow that far.
+static b8 builder_reserve(string_builder* builder, u64 count)
+{
+    u64 needed = builder->length + count + 1;
+    if (needed <= builder->capacity)
+        return TRUE;
+
+    linear_allocator* arena = builder->arena;
+    if (!arena)
+        return FALSE;
+
+    u64 capacity = builder->capacity * 2 > needed ? builder->capacity * 2 : needed;
+    capacity = align16(capacity);
+
+    // Still the newest allocation in the arena, so the buffer can simply be extended.
+    if ((u8*)builder->buffer + builder->capacity == (u8*)arena->memory + arena->allocated) {
+        if (!linear_allocator_allocate(arena, capacity - builder->capacity))
+            return FALSE;
+        builder->capacity = capacity;
+        return TRUE;
+    }
+
+    char* buffer = linear_allocator_allocate(arena, capacity);
+    if (!buffer)
+        return FALSE;
+
+    kcopy_memory(buffer, builder->buffer, builder->length + 1);
+    builder->buffer = buffer;
+    builder->capacity = capacity;
+    return TRUE;
+}
+
+static void builder_write(string_builder* builder, const char* data, u64 length)
+{
+    if (!builder_reserve(builder, length)) {
+        builder->truncated = TRUE;
+        length = builder->capacity - 1 - builder->length;
+    }
+
+    kcopy_memory(builder->buffer + builder->length, data, length);
+    builder->length += length;
+    builder->buffer[builder->length] = 0;
+}
+
+void string_builder_append(string_builder* builder, const char* str)
+{
+    builder_write(builder, str, string_length(str));
+}
+
+void string_builder_append_view(string_builder* builder, string_view view)
+{
+    builder_write(builder, view.str, view.length);
+}
+
+void string_builder_append_char(string_builder* builder, char c)
+{
+    builder_write(builder, &c, 1);
+}
+
+static const char digit_pairs[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// Writes the digits of value right to left, ending just before end. Returns the first digit.
+static char* format_u64(u64 value, char* end)
+{
+    // Two digits per division halves the number of divisions.
+    while (value >= 100) {
+        u32 pair = (u32)(value % 100) * 2;
+        value /= 100;
+        *--end = digit_pairs[pair + 1];
+        *--end = digit_pairs[pair];
+    }
+
+    if (value >= 10) {
+        *--end = digit_pairs[value * 2 + 1];
+        *--end = digit_pairs[value * 2];
+    } else {
+        *--end = (char)('0' + value);
+    }
+    return end;
+}
+
+void string_builder_append_u64(string_builder* builder, u64 value)
+{
+    char digits[20];
+    char* start = format_u64(value, digits + sizeof(digits));
+    builder_write(builder, start, (u64)(digits + sizeof(digits) - start));
+}
+
+void string_builder_append_i64(string_builder* builder, i64 value)
+{
+    char digits[21];
+    // Negate as unsigned, so the smallest i64 does not overflow.
+    u64 magnitude = value < 0 ? 0 - (u64)value : (u64)value;
+    char* start = format_u64(magnitude, digits + sizeof(digits));
+    if (value < 0)
+        *--start = '-';
+    builder_write(builder, start, (u64)(digits + sizeof(digits) - start));
+}
+
+void string_builder_append_f64(string_builder* builder, f64 value, u32 decimals)
+{
+    static const u64 powers_of_ten[10] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+    if (decimals > 9)
+        decimals = 9;
+
+    f64 magnitude = value < 0 ? -value : value;
+    f64 scaled = magnitude * (f64)powers_of_ten[decimals] + 0.5;
+
+    // NaN, infinities and values too large to scale into a u64 are left to printf.
+    if (!(scaled < 18446744073709551616.0)) {
+        string_builder_appendf(builder, "%.*f", decimals, value);
+        return;
+    }
+
+    u64 fixed = (u64)scaled;
+    u64 whole = fixed / powers_of_ten[decimals];
+    u64 fraction = fixed % powers_of_ten[decimals];
+
+    char digits[32];
+    char* end = digits + sizeof(digits);
+    char* start = end;
+    if (decimals) {
+        start = format_u64(fraction, end);
+        // Pad the fraction with leading zeros, e.g. 0.05 rather than 0.5.
+        while (end - start < decimals)
+            *--start = '0';
+        *--start = '.';
+    }
+    start = format_u64(whole, start);
+    if (value < 0 && fixed)
+        *--start = '-';
+
+    builder_write(builder, start, (u64)(end - start));
+}
+
+void string_builder_appendv(string_builder* builder, const char* format, __builtin_va_list args)
+{
+    __builtin_va_list retry;
+    va_copy(retry, args);
+
+    u64 available = builder->capacity - builder->length;
+    i32 needed = vsnprintf(builder->buffer + builder->length, available, format, args);
+    if (needed < 0) {
+        builder->buffer[builder->length] = 0;
+        va_end(retry);
+        return;
+    }
+
+    if ((u64)needed >= available) {
+        if (builder_reserve(builder, needed)) {
+            vsnprintf(builder->buffer + builder->length, builder->capacity - builder->length, format, retry);
+        } else {
+            // vsnprintf already wrote as much as fits.
+            builder->truncated = TRUE;
+            needed = (i32)(available - 1);
+        }
+    }
+
+    builder->length += needed;
+    va_end(retry);
+}
+
+void string_builder_appendf(string_builder* builder, const char* format, ...)
+{
+    __builtin_va_list args;
+    va_start(args, format);
+    string_builder_appendv(builder, format, args);
+    va_end(args);
 }
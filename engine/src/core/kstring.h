@@ -2,6 +2,8 @@
 
 #include "defines.h"
 
+struct linear_allocator;
+
 // Returns the length of the given string
 KAPI u64 string_length(const char* str);
 
@@ -9,3 +11,90 @@ KAPI char* string_duplicate(const char* str);
 
 // Case-sensitive string comparison. True if the same, otherwise false
 KAPI b8 strings_equal(const char* str0, const char* str1);
+
+// Returns the index of the first occurrence of needle in haystack, or -1 if there is none.
+KAPI i64 string_find(const char* haystack, const char* needle);
+
+/**
+ * A non-owning view of a run of characters, which need not be null-terminated. Passing views
+ * around keeps the length known, so it never has to be found again.
+ */
+typedef struct string_view {
+    const char* str;
+    u64 length;
+} string_view;
+
+// A view of a string literal, with the length known at compile time.
+#define STRING_VIEW_LITERAL(literal) ((string_view){ "" literal, sizeof(literal) - 1 })
+
+KAPI string_view string_view_create(const char* str);
+
+KAPI b8 string_view_equal(string_view a, string_view b);
+
+// Returns the index of the first occurrence of needle in haystack, or -1 if there is none.
+KAPI i64 string_view_find(string_view haystack, string_view needle);
+
+// Returns the part of the view from start on, at most length characters long. Clamped to the view.
+KAPI string_view string_view_substring(string_view view, u64 start, u64 length);
+
+KAPI b8 string_view_starts_with(string_view view, string_view prefix);
+KAPI b8 string_view_ends_with(string_view view, string_view suffix);
+
+/**
+ * Builds a string by appending pieces to it, without allocating from the heap. Writes either into
+ * a caller-provided buffer, truncating once it is full, or into a linear allocator, growing as
+ * needed. The buffer is null-terminated after every append.
+ */
+typedef struct string_builder {
+    char* buffer;
+    u64 length;
+    // The size of the buffer, including room for the terminator.
+    u64 capacity;
+    // The allocator to grow into, or 0/NULL for a fixed buffer.
+    struct linear_allocator* arena;
+    // Set once anything was cut off for lack of room.
+    b8 truncated;
+} string_builder;
+
+/**
+ * Creates a string builder over a caller-provided buffer.
+ * @param buffer The buffer to write into.
+ * @param size The size of the buffer in bytes, including room for the terminator. Must not be 0.
+ * @param out_builder A pointer to hold the builder.
+ */
+KAPI void string_builder_create(char* buffer, u64 size, string_builder* out_builder);
+
+/**
+ * Creates a string builder that allocates from a linear allocator. As long as nothing else is
+ * allocated from it in between, the string grows in place.
+ * @param arena The allocator to allocate from.
+ * @param capacity The number of characters to make room for up front.
+ * @param out_builder A pointer to hold the builder.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 string_builder_create_arena(struct linear_allocator* arena, u64 capacity, string_builder* out_builder);
+
+// Empties the string, keeping the buffer.
+KAPI void string_builder_reset(string_builder* builder);
+
+KAPI void string_builder_append(string_builder* builder, const char* str);
+KAPI void string_builder_append_view(string_builder* builder, string_view view);
+KAPI void string_builder_append_char(string_builder* builder, char c);
+KAPI void string_builder_append_u64(string_builder* builder, u64 value);
+KAPI void string_builder_append_i64(string_builder* builder, i64 value);
+
+/**
+ * Appends a number with a fixed number of decimals, like "%.*f" but without going through printf
+ * for values that fit in 64 bits once scaled. Halves round away from zero.
+ * @param builder A pointer to the builder.
+ * @param value The number.
+ * @param decimals The number of digits after the point, at most 9.
+ */
+KAPI void string_builder_append_f64(string_builder* builder, f64 value, u32 decimals);
+
+// Appends printf-style formatted text, for anything the typed appends do not cover.
+KAPI void string_builder_appendf(string_builder* builder, const char* format, ...);
+KAPI void string_builder_appendv(string_builder* builder, const char* format, __builtin_va_list args);
+
+#define string_builder_view(builder) \
+    ((string_view){ (builder)->buffer, (builder)->length })
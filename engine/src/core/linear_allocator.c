@@ -0,0 +1,96 @@
+#include "linear_allocator.h"
+
+#include "core/logger.h"
+
+void linear_allocator_create(u64 total_size, void* memory, linear_allocator* out_allocator)
+{
+    if (!out_allocator)
+        return;
+
+    kzero_memory(out_allocator, sizeof(linear_allocator));
+    out_allocator->total_size = total_size;
+    out_allocator->allocated = 0;
+    out_allocator->owns_memory = memory == 0;
+
+    if (memory) {
+        out_allocator->memory = memory;
+    } else {
+        out_allocator->memory = kallocate_uninitialized(total_size, MEMORY_TAG_LINEAR_ALLOCATOR);
+    }
+}
+
+b8 linear_allocator_create_virtual(u64 max_size, b8 large_pages, linear_allocator* out_allocator)
+{
+    if (!out_allocator)
+        return FALSE;
+
+    kzero_memory(out_allocator, sizeof(linear_allocator));
+
+    if (!kvirtual_reserve(max_size, large_pages, MEMORY_TAG_LINEAR_ALLOCATOR, &out_allocator->virtual_memory))
+        return FALSE;
+
+    out_allocator->is_virtual = TRUE;
+    out_allocator->owns_memory = TRUE;
+    out_allocator->memory = out_allocator->virtual_memory.base;
+    out_allocator->total_size = out_allocator->virtual_memory.reserved;
+    return TRUE;
+}
+
+void linear_allocator_destroy(linear_allocator* allocator)
+{
+    if (!allocator)
+        return;
+
+    if (allocator->is_virtual) {
+        kvirtual_release(&allocator->virtual_memory);
+    } else if (allocator->owns_memory && allocator->memory) {
+        kfree(allocator->memory, allocator->total_size, MEMORY_TAG_LINEAR_ALLOCATOR);
+    }
+
+    allocator->memory = 0;
+    allocator->total_size = 0;
+    allocator->allocated = 0;
+    allocator->owns_memory = FALSE;
+    allocator->is_virtual = FALSE;
+}
+
+void* linear_allocator_allocate(linear_allocator* allocator, u64 size)
+{
+    if (!allocator || !allocator->memory) {
+        KERROR("linear_allocator_allocate - provided allocator not initialized.");
+        return 0;
+    }
+
+    // Round the offset up so every block starts on an aligned address.
+    u64 offset = (allocator->allocated + (LINEAR_ALLOCATOR_ALIGNMENT - 1)) & ~((u64)LINEAR_ALLOCATOR_ALIGNMENT - 1);
+
+    if (offset + size > allocator->total_size) {
+        u64 remaining = allocator->total_size - allocator->allocated;
+        KERROR("linear_allocator_allocate - Tried to allocate %lluB, only %lluB remaining.", size, remaining);
+        return 0;
+    }
+
+    if (allocator->is_virtual && offset + size > allocator->virtual_memory.committed) {
+        // Grow in place, committing a little ahead to keep the number of commits down.
+        u64 commit_size = offset + size + LINEAR_ALLOCATOR_COMMIT_GRANULARITY - 1;
+        commit_size -= commit_size % LINEAR_ALLOCATOR_COMMIT_GRANULARITY;
+        if (commit_size > allocator->total_size)
+            commit_size = allocator->total_size;
+
+        if (!kvirtual_commit(&allocator->virtual_memory, commit_size)) {
+            KERROR("linear_allocator_allocate - Unable to grow to %lluB.", offset + size);
+            return 0;
+        }
+    }
+
+    allocator->allocated = offset + size;
+    return (u8*)allocator->memory + offset;
+}
+
+void linear_allocator_free_all(linear_allocator* allocator)
+{
+    if (allocator && allocator->memory) {
+        // NOTE: The block is intentionally not zeroed; it is scratch memory.
+        allocator->allocated = 0;
+    }
+}
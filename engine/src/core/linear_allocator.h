@@ -0,0 +1,68 @@
+#pragma once
+
+#include "defines.h"
+#include "core/kmemory.h"
+
+/**
+ * A linear (bump) allocator. Allocations are served by moving an offset forward
+ * inside a single block of memory, and are never freed individually. The whole
+ * block is released at once through linear_allocator_free_all, which makes it
+ * a good fit for data that shares a lifetime, such as per-frame scratch memory.
+ */
+typedef struct linear_allocator {
+    u64 total_size;
+    u64 allocated;
+    void* memory;
+    b8 owns_memory;
+
+    // Set when the allocator grows in place inside a virtual memory reservation.
+    b8 is_virtual;
+    kvirtual_memory virtual_memory;
+} linear_allocator;
+
+// Virtual linear allocators commit memory in steps of at least this many bytes.
+#define LINEAR_ALLOCATOR_COMMIT_GRANULARITY KIBIBYTES(64)
+
+// Every allocation handed out by a linear allocator is aligned to this many bytes.
+#define LINEAR_ALLOCATOR_ALIGNMENT 16
+
+/**
+ * Creates a linear allocator.
+ * @param total_size The size in bytes of the block the allocator manages.
+ * @param memory A pre-allocated block of at least total_size bytes, or 0/NULL to have the
+ * allocator allocate (and later free) its own block.
+ * @param out_allocator A pointer to hold the created allocator.
+ */
+KAPI void linear_allocator_create(u64 total_size, void* memory, linear_allocator* out_allocator);
+
+/**
+ * Creates a linear allocator that reserves address space for max_size bytes, but only commits
+ * memory as allocations reach into it. The allocator grows in place, so pointers stay valid.
+ * @param max_size The most bytes the allocator will ever hold.
+ * @param large_pages If TRUE, back the allocator with large pages where available. Large pages are
+ * committed in full up front.
+ * @param out_allocator A pointer to hold the created allocator.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 linear_allocator_create_virtual(u64 max_size, b8 large_pages, linear_allocator* out_allocator);
+
+/**
+ * Destroys the provided allocator, freeing its block if the allocator owns it.
+ * @param allocator A pointer to the allocator to be destroyed.
+ */
+KAPI void linear_allocator_destroy(linear_allocator* allocator);
+
+/**
+ * Allocates a block of the given size from the allocator. The memory is NOT zeroed.
+ * @param allocator A pointer to the allocator to allocate from.
+ * @param size The size in bytes to be allocated.
+ * @returns A pointer to the allocated block, or 0/NULL if the allocator is out of space.
+ */
+KAPI void* linear_allocator_allocate(linear_allocator* allocator, u64 size);
+
+/**
+ * Releases every allocation made from the allocator at once by resetting its offset.
+ * Previously returned pointers must not be used after this call.
+ * @param allocator A pointer to the allocator to be reset.
+ */
+KAPI void linear_allocator_free_all(linear_allocator* allocator);
@@ -2,10 +2,10 @@
 #include "asserts.h"
 #include "platform/platform.h"
 
+#include "core/kstring.h"
+
 // FIXME: Temporary
 #include <stdarg.h>
-#include <stdio.h>
-#include <string.h>
 
 b8 initilialize_logging()
 {
@@ -23,24 +23,26 @@ void log_output(log_level level, const char* message, ...)
     const char* level_strings[6] = { "[FATAL]: ", "[ERROR]: ", "[WARN]: ", "[INFO]: ", "[DEBUG]: ", "[TRACE]: " };
     b8 is_error = level < LOG_LEVEL_WARN;
 
-    // 32K character limit on a log entry
-    const i32 msg_length = 32000;
-    char out_message[msg_length];
-    memset(out_message, 0, sizeof(out_message));
+    // 32K character limit on a log entry. The prefix, message and newline are formatted in one
+    // pass into a single buffer. One byte is held back so the newline always fits.
+    char out_message[32000];
+    string_builder builder;
+    string_builder_create(out_message, sizeof(out_message) - 1, &builder);
+    string_builder_append(&builder, level_strings[level]);
 
     __builtin_va_list arg_ptr;
     va_start(arg_ptr, message);
-    vsnprintf(out_message, msg_length, message, arg_ptr);
+    string_builder_appendv(&builder, message, arg_ptr);
     va_end(arg_ptr);
 
-    char out_message2[32000];
-    sprintf(out_message2, "%s%s\n", level_strings[level], out_message);
+    out_message[builder.length] = '\n';
+    out_message[builder.length + 1] = 0;
 
     // Platform-specific log output
     if (is_error) {
-        platform_console_write_error(out_message2, level);
+        platform_console_write_error(out_message, level);
     } else {
-        platform_console_write(out_message2, level);
+        platform_console_write(out_message, level);
     }
 }
 
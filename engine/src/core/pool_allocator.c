@@ -0,0 +1,136 @@
+#include "pool_allocator.h"
+
+#include "core/logger.h"
+
+// Lives at the start of each page, ahead of the objects.
+typedef struct pool_page_header {
+    struct pool_page_header* next;
+} pool_page_header;
+
+static u64 page_header_size(const pool_allocator* pool)
+{
+    return (sizeof(pool_page_header) + pool->alignment - 1) & ~(pool->alignment - 1);
+}
+
+static u64 page_size(const pool_allocator* pool)
+{
+    return page_header_size(pool) + pool->stride * pool->objects_per_page;
+}
+
+static u16 page_alignment(const pool_allocator* pool)
+{
+    return pool->alignment > KMEMORY_DEFAULT_ALIGNMENT ? (u16)pool->alignment : KMEMORY_DEFAULT_ALIGNMENT;
+}
+
+b8 pool_allocator_create(u64 object_size, u64 alignment, u64 objects_per_page, memory_tag tag, pool_allocator* out_pool)
+{
+    if (!out_pool || object_size == 0 || objects_per_page == 0) {
+        KERROR("pool_allocator_create requires a non-zero object size and objects_per_page.");
+        return FALSE;
+    }
+
+    // The free list link is stored inside free objects, so each slot must be able to hold a pointer.
+    if (alignment < sizeof(void*))
+        alignment = sizeof(void*);
+
+    if ((alignment & (alignment - 1)) || alignment > KMEMORY_MAX_ALIGNMENT) {
+        KERROR("pool_allocator_create - alignment must be a power of two no larger than %i.", KMEMORY_MAX_ALIGNMENT);
+        return FALSE;
+    }
+
+    if (object_size < sizeof(void*))
+        object_size = sizeof(void*);
+
+    kzero_memory(out_pool, sizeof(pool_allocator));
+    out_pool->stride = (object_size + alignment - 1) & ~(alignment - 1);
+    out_pool->alignment = alignment;
+    out_pool->objects_per_page = objects_per_page;
+    out_pool->tag = tag;
+
+    return TRUE;
+}
+
+void pool_allocator_destroy(pool_allocator* pool)
+{
+    if (!pool)
+        return;
+
+    u64 size = page_size(pool);
+    pool_page_header* page = pool->pages;
+    while (page) {
+        pool_page_header* next = page->next;
+        kfree_aligned(page, size, page_alignment(pool), pool->tag);
+        page = next;
+    }
+
+    kzero_memory(pool, sizeof(pool_allocator));
+}
+
+void* pool_allocator_allocate(pool_allocator* pool)
+{
+    void* object = 0;
+
+    if (pool->free_list) {
+        object = pool->free_list;
+        pool->free_list = *(void**)object;
+    } else {
+        if (pool->bump == pool->bump_end) {
+            pool_page_header* page = kallocate_aligned_uninitialized(page_size(pool), page_alignment(pool), pool->tag);
+            if (!page) {
+                KERROR("pool_allocator_allocate - unable to allocate a new page.");
+                return 0;
+            }
+
+            page->next = pool->pages;
+            pool->pages = page;
+            pool->page_count++;
+
+            pool->bump = (u8*)page + page_header_size(pool);
+            pool->bump_end = pool->bump + pool->stride * pool->objects_per_page;
+        }
+
+        object = pool->bump;
+        pool->bump += pool->stride;
+    }
+
+    // Recycled slots hold stale data, and so do pages reused after pool_allocator_free_all.
+    kzero_memory(object, pool->stride);
+    pool->allocated_count++;
+    return object;
+}
+
+void pool_allocator_free(pool_allocator* pool, void* object)
+{
+    if (!object)
+        return;
+
+    *(void**)object = pool->free_list;
+    pool->free_list = object;
+    pool->allocated_count--;
+}
+
+void pool_allocator_free_all(pool_allocator* pool)
+{
+    pool->free_list = 0;
+    pool->allocated_count = 0;
+
+    // Thread every page except the newest onto the free list, and bump through the newest again.
+    u64 header_size = page_header_size(pool);
+    pool_page_header* page = pool->pages;
+    if (!page) {
+        pool->bump = pool->bump_end = 0;
+        return;
+    }
+
+    pool->bump = (u8*)page + header_size;
+    pool->bump_end = pool->bump + pool->stride * pool->objects_per_page;
+
+    for (page = page->next; page; page = page->next) {
+        u8* first = (u8*)page + header_size;
+        for (u64 i = 0; i < pool->objects_per_page; ++i) {
+            void* object = first + i * pool->stride;
+            *(void**)object = pool->free_list;
+            pool->free_list = object;
+        }
+    }
+}
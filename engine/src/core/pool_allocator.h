@@ -0,0 +1,79 @@
+#pragma once
+
+#include "defines.h"
+#include "core/kmemory.h"
+
+/**
+ * A pool allocator for objects of a single fixed size. Objects are carved out of large,
+ * contiguous pages, and freed objects are kept on an intrusive free list, so both
+ * allocation and freeing are O(1) and never touch the heap once a page exists.
+ * Pages are accounted under the pool's memory tag and are only released on destroy.
+ */
+typedef struct pool_allocator {
+    // Size in bytes of each slot, object size rounded up to the alignment.
+    u64 stride;
+    u64 alignment;
+    u64 objects_per_page;
+    memory_tag tag;
+
+    // Singly linked list of freed objects, stored in the objects themselves.
+    void* free_list;
+
+    // Unused tail of the newest page. Handed out before a new page is allocated.
+    u8* bump;
+    u8* bump_end;
+
+    // Singly linked list of pages, the link is stored in each page header.
+    void* pages;
+    u64 page_count;
+
+    // The number of objects currently handed out.
+    u64 allocated_count;
+} pool_allocator;
+
+/**
+ * Creates a pool allocator. No memory is allocated until the first object is.
+ * @param object_size The size in bytes of a single object.
+ * @param alignment The required alignment of each object. Must be a power of two no larger than KMEMORY_MAX_ALIGNMENT.
+ * @param objects_per_page The number of objects that fit in one page of backing memory.
+ * @param tag The memory tag the pages are accounted under.
+ * @param out_pool A pointer to hold the created pool.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 pool_allocator_create(u64 object_size, u64 alignment, u64 objects_per_page, memory_tag tag, pool_allocator* out_pool);
+
+/**
+ * Destroys the pool, releasing every page. Objects still allocated become invalid.
+ * @param pool A pointer to the pool to be destroyed.
+ */
+KAPI void pool_allocator_destroy(pool_allocator* pool);
+
+/**
+ * Allocates a single zeroed object from the pool.
+ * @param pool A pointer to the pool to allocate from.
+ * @returns A pointer to the object, or 0/NULL on failure.
+ */
+KAPI void* pool_allocator_allocate(pool_allocator* pool);
+
+/**
+ * Returns an object to the pool.
+ * @param pool A pointer to the pool the object was allocated from.
+ * @param object The object to be freed.
+ */
+KAPI void pool_allocator_free(pool_allocator* pool, void* object);
+
+/**
+ * Returns every object to the pool at once, keeping the pages for reuse. Takes time proportional
+ * to the pool's capacity, as every slot on every page but the newest goes back on the free list.
+ * @param pool A pointer to the pool to be reset.
+ */
+KAPI void pool_allocator_free_all(pool_allocator* pool);
+
+#define pool_allocator_create_typed(type, objects_per_page, tag, out_pool) \
+    pool_allocator_create(sizeof(type), _Alignof(type), objects_per_page, tag, out_pool)
+
+#define pool_allocate(pool, type) \
+    ((type*)pool_allocator_allocate(pool))
+
+#define pool_free(pool, object) \
+    pool_allocator_free(pool, object)
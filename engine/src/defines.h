@@ -44,6 +44,11 @@ STATIC_ASSERT(sizeof(f64) == 8, "Expected f64 to be 8 bytes.");
 #define TRUE 1
 #define FALSE 0
 
+// Byte size helpers
+#define KIBIBYTES(amount) ((amount) * 1024ULL)
+#define MEBIBYTES(amount) ((amount) * 1024ULL * 1024ULL)
+#define GIBIBYTES(amount) ((amount) * 1024ULL * 1024ULL * 1024ULL)
+
 // Platform detection
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__)
 #define KPLATFORM_WINDOWS 1
@@ -8,16 +8,40 @@
 // Externaly defined function to create a game;
 extern b8 create_game(game* out_game);
 
+// The amount of memory the engine reserves up front. Define before including entry.h to override.
+#ifndef KOHI_MEMORY_TOTAL_SIZE
+#define KOHI_MEMORY_TOTAL_SIZE MEBIBYTES(256)
+#endif
+
+// If TRUE, the engine never allocates beyond KOHI_MEMORY_TOTAL_SIZE. Define before including entry.h to override.
+#ifndef KOHI_MEMORY_HARD_LIMIT
+#define KOHI_MEMORY_HARD_LIMIT FALSE
+#endif
+
+// If TRUE, the engine backs its memory with large pages where available. Define before including entry.h to override.
+#ifndef KOHI_MEMORY_USE_LARGE_PAGES
+#define KOHI_MEMORY_USE_LARGE_PAGES FALSE
+#endif
+
 /**
  *  The main entry point of the application 
  */
 
 int main(void)
 {
-    initialize_memory();
+    memory_system_configuration memory_config = {
+        .total_alloc_size = KOHI_MEMORY_TOTAL_SIZE,
+        .hard_limit = KOHI_MEMORY_HARD_LIMIT,
+        .use_large_pages = KOHI_MEMORY_USE_LARGE_PAGES,
+    };
+
+    if (!initialize_memory(memory_config)) {
+        KFATAL("Failed to initialize the memory system!");
+        return -3;
+    }
 
-    // Request the game instance from the application
-    game game_inst;
+    // Request the game instance from the application. Zeroed first, so any config the game leaves alone takes its default.
+    game game_inst = {0};
 
     if (!create_game(&game_inst)) {
         KFATAL("Could not create game!");
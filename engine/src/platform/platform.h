@@ -12,11 +12,62 @@ void platform_shutdown(platform_state* plat_state);
 
 b8 platform_pump_messages(platform_state* plat_state);
 
+// Allocates a block of memory. If aligned is TRUE, the block is aligned to PLATFORM_DEFAULT_ALIGNMENT
+// and must be freed with aligned set to TRUE as well.
 void* platform_allocate(u64 size, b8 aligned);
 void platform_free(void* block, b8 aligned);
 
+#define PLATFORM_DEFAULT_ALIGNMENT 16
+
+// Allocates a block of memory aligned to the given power of two. Must be freed with platform_free_aligned.
+void* platform_allocate_aligned(u64 size, u64 alignment);
+void platform_free_aligned(void* block);
+
+/**
+ * Virtual memory. Address space is reserved up front and backed by physical memory in
+ * pieces as it is committed, so a reservation can grow in place without moving.
+ */
+typedef enum platform_memory_advice {
+    // The range is about to be accessed, start paging it in.
+    PLATFORM_MEMORY_ADVICE_WILL_NEED,
+    // The contents of the range are no longer needed. It stays committed, but may read back as anything.
+    PLATFORM_MEMORY_ADVICE_DONT_NEED,
+    // Back the range with huge pages where the OS supports doing so transparently.
+    PLATFORM_MEMORY_ADVICE_HUGE_PAGES,
+} platform_memory_advice;
+
+// The size of a regular page in bytes. Commits and decommits are made in multiples of this.
+u64 platform_page_size();
+
+// The size of a large/huge page in bytes, or 0 if the platform cannot provide them.
+u64 platform_large_page_size();
+
+/**
+ * Reserves a range of address space. Regular reservations are not backed by memory until committed.
+ * A reservation using large pages is committed in full right away, because the OS can only hand
+ * out large pages that way, and its size must be a multiple of platform_large_page_size.
+ * @param size The size in bytes to reserve.
+ * @param large_pages Whether to back the range with large pages.
+ * @returns The base address of the range, or 0/NULL on failure (including large pages being unavailable).
+ */
+void* platform_reserve_memory(u64 size, b8 large_pages);
+
+// Backs a page aligned range of a reservation with memory. Newly committed memory reads as zero.
+b8 platform_commit_memory(void* address, u64 size);
+
+// Returns the memory behind a page aligned range of a reservation to the OS, keeping the address space.
+b8 platform_decommit_memory(void* address, u64 size);
+
+// Releases a whole reservation.
+void platform_release_memory(void* address, u64 size);
+
+// Gives the OS a hint about how a range of a reservation is going to be used.
+void platform_advise_memory(void* address, u64 size, platform_memory_advice advice);
+
 void* platform_zero_memory(void* block, u64 size);
 void* platform_copy_memory(void* dest, const void* source, u64 size);
+// Like platform_copy_memory, but the ranges may overlap.
+void* platform_move_memory(void* dest, const void* source, u64 size);
 void* platform_set_memory(void* dest, i32 value, u64 size);
 
 void platform_console_write(const char* message, u8 colour);
@@ -27,4 +78,7 @@ f64 platform_get_absolute_time();
 // Sleep on the thread for the provided ms. This blocks the main thread.
 // Should only be used for giving time back to the OS for unused update power.
 // Therefore it is not exported.
-void platform_sleep(u64 ms);
\ No newline at end of file
+void platform_sleep(u64 ms);
+
+// Gives up the rest of the calling thread's time slice, if another thread is ready to run on the same core.
+void platform_yield();
\ No newline at end of file
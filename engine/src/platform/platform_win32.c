@@ -8,6 +8,7 @@
 
 #include "containers/darray.h"
 
+#include <malloc.h>
 #include <stdio.h>
 #include <windows.h>
 #include <windowsx.h>
@@ -138,14 +139,121 @@ b8 platform_pump_messages(platform_state* plat_state)
 
 void* platform_allocate(u64 size, b8 aligned)
 {
+    if (aligned)
+        return platform_allocate_aligned(size, PLATFORM_DEFAULT_ALIGNMENT);
+
     return malloc(size);
 }
 
 void platform_free(void* block, b8 aligned)
 {
+    if (aligned) {
+        platform_free_aligned(block);
+        return;
+    }
+
     free(block);
 }
 
+void* platform_allocate_aligned(u64 size, u64 alignment)
+{
+    return _aligned_malloc(size, alignment);
+}
+
+void platform_free_aligned(void* block)
+{
+    _aligned_free(block);
+}
+
+u64 platform_page_size()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+}
+
+u64 platform_large_page_size()
+{
+    return GetLargePageMinimum();
+}
+
+// Large pages can only be allocated by a process holding SeLockMemoryPrivilege, which must be
+// granted by policy and then enabled on the process token.
+static b8 enable_lock_memory_privilege()
+{
+    static b8 attempted = FALSE;
+    static b8 enabled = FALSE;
+
+    if (attempted)
+        return enabled;
+    attempted = TRUE;
+
+    HANDLE token;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+        return FALSE;
+
+    TOKEN_PRIVILEGES privileges = { .PrivilegeCount = 1 };
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+    if (LookupPrivilegeValueA(0, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid)) {
+        AdjustTokenPrivileges(token, FALSE, &privileges, 0, 0, 0);
+        // AdjustTokenPrivileges succeeds even if the privilege was not held, so check explicitly.
+        enabled = GetLastError() == ERROR_SUCCESS;
+    }
+
+    CloseHandle(token);
+
+    if (!enabled)
+        KWARN("SeLockMemoryPrivilege is not held, large pages are unavailable.");
+
+    return enabled;
+}
+
+void* platform_reserve_memory(u64 size, b8 large_pages)
+{
+    if (large_pages) {
+        u64 large_page_size = GetLargePageMinimum();
+        if (large_page_size == 0 || size % large_page_size != 0 || !enable_lock_memory_privilege())
+            return 0;
+
+        return VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    }
+
+    return VirtualAlloc(0, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+b8 platform_commit_memory(void* address, u64 size)
+{
+    return VirtualAlloc(address, size, MEM_COMMIT, PAGE_READWRITE) != 0;
+}
+
+b8 platform_decommit_memory(void* address, u64 size)
+{
+    return VirtualFree(address, size, MEM_DECOMMIT) != 0;
+}
+
+void platform_release_memory(void* address, u64 size)
+{
+    // The whole reservation is released at once, so size must be 0 here.
+    VirtualFree(address, 0, MEM_RELEASE);
+}
+
+void platform_advise_memory(void* address, u64 size, platform_memory_advice advice)
+{
+    switch (advice) {
+    case PLATFORM_MEMORY_ADVICE_WILL_NEED: {
+        WIN32_MEMORY_RANGE_ENTRY range = { .VirtualAddress = address, .NumberOfBytes = size };
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    } break;
+    case PLATFORM_MEMORY_ADVICE_DONT_NEED:
+        VirtualAlloc(address, size, MEM_RESET, PAGE_READWRITE);
+        break;
+    case PLATFORM_MEMORY_ADVICE_HUGE_PAGES:
+        // Windows has no transparent large pages, they must be requested at reservation.
+        break;
+    }
+}
+
 void* platform_zero_memory(void* block, u64 size)
 {
     return memset(block, 0, size);
@@ -156,6 +264,11 @@ void* platform_copy_memory(void* dest, const void* source, u64 size)
     return memcpy(dest, source, size);
 }
 
+void* platform_move_memory(void* dest, const void* source, u64 size)
+{
+    return memmove(dest, source, size);
+}
+
 void* platform_set_memory(void* dest, i32 value, u64 size)
 {
     return memset(dest, value, size);
@@ -199,6 +312,11 @@ void platform_sleep(u64 ms)
     Sleep(ms);
 }
 
+void platform_yield()
+{
+    SwitchToThread();
+}
+
 void platform_get_required_extension_names(const char*** names_darray)
 {
     darray_push(*names_darray, &"VK_KHR_win32_surface");
@@ -0,0 +1,272 @@
+#include "vulkan_allocator.h"
+
+#include "core/kmemory.h"
+#include "core/logger.h"
+
+/**
+ * Sits right in front of every pointer handed to the driver, so a free or reallocation knows the
+ * block the pointer lives in without being told its size.
+ */
+typedef struct vulkan_allocation_header {
+    // The block actually allocated. Unused for arena allocations.
+    void* block;
+    u64 block_size;
+    // The size the driver asked for.
+    u64 size;
+    // The arena the allocation was served from, or 0/NULL if it came from kmemory.
+    vulkan_command_arena* arena;
+    u16 block_alignment;
+    u8 scope;
+} vulkan_allocation_header;
+
+static const char* scope_names[VULKAN_ALLOCATION_SCOPE_COUNT] = {
+    "command",
+    "object",
+    "cache",
+    "device",
+    "instance"
+};
+
+// Bumped on every create, so threads notice when the arena they cached belongs to an allocator that is gone.
+static u32 allocator_generation = 0;
+
+static _Thread_local vulkan_command_arena* thread_arena = 0;
+static _Thread_local u32 thread_arena_generation = 0;
+
+static u64 align_up(u64 value, u64 alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static vulkan_allocation_header* header_of(void* memory)
+{
+    return (vulkan_allocation_header*)memory - 1;
+}
+
+static void stats_allocated(vulkan_host_allocator* allocator, u8 scope, u64 size)
+{
+    vulkan_host_allocation_stats* stats = &allocator->stats[scope];
+    u64 allocated = __atomic_add_fetch(&stats->allocated, size, __ATOMIC_RELAXED);
+
+    u64 peak = __atomic_load_n(&stats->peak_allocated, __ATOMIC_RELAXED);
+    while (allocated > peak && !__atomic_compare_exchange_n(&stats->peak_allocated, &peak, allocated, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void stats_freed(vulkan_host_allocator* allocator, u8 scope, u64 size)
+{
+    __atomic_fetch_sub(&allocator->stats[scope].allocated, size, __ATOMIC_RELAXED);
+}
+
+// Gets the calling thread's arena, claiming one on first use. Returns 0/NULL once they are all taken.
+static vulkan_command_arena* command_arena_get(vulkan_host_allocator* allocator)
+{
+    if (thread_arena_generation == allocator->generation)
+        return thread_arena;
+
+    thread_arena_generation = allocator->generation;
+    thread_arena = 0;
+
+    u32 index = __atomic_fetch_add(&allocator->arena_count, 1, __ATOMIC_RELAXED);
+    if (index >= VULKAN_MAX_COMMAND_ARENAS)
+        return 0;
+
+    vulkan_command_arena* arena = &allocator->arenas[index];
+    arena->memory = kallocate_aligned_uninitialized(VULKAN_COMMAND_ARENA_SIZE, 64, MEMORY_TAG_RENDERER);
+    if (!arena->memory)
+        return 0;
+
+    arena->size = VULKAN_COMMAND_ARENA_SIZE;
+    arena->offset = 0;
+    arena->live_count = 0;
+    thread_arena = arena;
+    return arena;
+}
+
+static void* command_arena_allocate(vulkan_command_arena* arena, u64 size, u64 alignment)
+{
+    // Nothing in the arena is live, start over from the beginning.
+    if (__atomic_load_n(&arena->live_count, __ATOMIC_ACQUIRE) == 0)
+        arena->offset = 0;
+
+    u64 base = (u64)arena->memory;
+    u64 address = align_up(base + arena->offset + sizeof(vulkan_allocation_header), alignment);
+    if (address + size > base + arena->size)
+        return 0;
+
+    vulkan_allocation_header* header = header_of((void*)address);
+    header->block = 0;
+    header->block_size = 0;
+    header->size = size;
+    header->arena = arena;
+    header->block_alignment = 0;
+    header->scope = VK_SYSTEM_ALLOCATION_SCOPE_COMMAND;
+
+    arena->offset = address + size - base;
+    __atomic_fetch_add(&arena->live_count, 1, __ATOMIC_RELAXED);
+    return (void*)address;
+}
+
+static void* heap_allocate(u64 size, u64 alignment, u8 scope)
+{
+    // Drivers may ask for more alignment than kmemory hands out, the difference is made up by padding.
+    u16 block_alignment = alignment < KMEMORY_MAX_ALIGNMENT ? alignment : KMEMORY_MAX_ALIGNMENT;
+    u64 block_size = size + align_up(sizeof(vulkan_allocation_header), block_alignment) + (alignment - block_alignment);
+
+    void* block = kallocate_aligned_uninitialized(block_size, block_alignment, MEMORY_TAG_RENDERER);
+    if (!block)
+        return 0;
+
+    u64 address = align_up((u64)block + sizeof(vulkan_allocation_header), alignment);
+    vulkan_allocation_header* header = header_of((void*)address);
+    header->block = block;
+    header->block_size = block_size;
+    header->size = size;
+    header->arena = 0;
+    header->block_alignment = block_alignment;
+    header->scope = scope;
+    return (void*)address;
+}
+
+static void allocation_free(vulkan_host_allocator* allocator, void* memory)
+{
+    vulkan_allocation_header* header = header_of(memory);
+    stats_freed(allocator, header->scope, header->size);
+
+    if (header->arena) {
+        __atomic_fetch_sub(&header->arena->live_count, 1, __ATOMIC_RELEASE);
+    } else {
+        kfree_aligned(header->block, header->block_size, header->block_alignment, MEMORY_TAG_RENDERER);
+    }
+}
+
+static void* VKAPI_PTR vulkan_host_allocation(void* user_data, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    vulkan_host_allocator* allocator = user_data;
+    if (size == 0)
+        return 0;
+
+    if (alignment < KMEMORY_DEFAULT_ALIGNMENT)
+        alignment = KMEMORY_DEFAULT_ALIGNMENT;
+
+    void* memory = 0;
+    if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND) {
+        vulkan_command_arena* arena = command_arena_get(allocator);
+        if (arena)
+            memory = command_arena_allocate(arena, size, alignment);
+        if (memory)
+            __atomic_fetch_add(&allocator->stats[scope].arena_allocation_count, 1, __ATOMIC_RELAXED);
+    }
+
+    if (!memory)
+        memory = heap_allocate(size, alignment, scope);
+
+    if (memory) {
+        stats_allocated(allocator, scope, size);
+        __atomic_fetch_add(&allocator->stats[scope].allocation_count, 1, __ATOMIC_RELAXED);
+    }
+    return memory;
+}
+
+static void VKAPI_PTR vulkan_host_free(void* user_data, void* memory)
+{
+    if (memory)
+        allocation_free(user_data, memory);
+}
+
+static void* VKAPI_PTR vulkan_host_reallocation(void* user_data, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    vulkan_host_allocator* allocator = user_data;
+    if (!original)
+        return vulkan_host_allocation(user_data, size, alignment, scope);
+
+    if (size == 0) {
+        allocation_free(allocator, original);
+        return 0;
+    }
+
+    __atomic_fetch_add(&allocator->stats[scope].reallocation_count, 1, __ATOMIC_RELAXED);
+    vulkan_allocation_header* header = header_of(original);
+
+    // The latest allocation in an arena can simply grow or shrink in place.
+    vulkan_command_arena* arena = header->arena;
+    if (arena && arena == thread_arena && ((u64)original & (alignment - 1)) == 0 && (u64)original + header->size == (u64)arena->memory + arena->offset
+        && (u64)original - (u64)arena->memory + size <= arena->size) {
+        stats_freed(allocator, header->scope, header->size);
+        stats_allocated(allocator, header->scope, size);
+        header->size = size;
+        arena->offset = (u64)original - (u64)arena->memory + size;
+        return original;
+    }
+
+    void* memory = vulkan_host_allocation(user_data, size, alignment, scope);
+    if (!memory)
+        return 0;
+
+    kcopy_memory(memory, original, header->size < size ? header->size : size);
+    allocation_free(allocator, original);
+    return memory;
+}
+
+static void VKAPI_PTR vulkan_host_internal_allocation(void* user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+    vulkan_host_allocator* allocator = user_data;
+    __atomic_fetch_add(&allocator->stats[scope].internal_allocated, size, __ATOMIC_RELAXED);
+}
+
+static void VKAPI_PTR vulkan_host_internal_free(void* user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+    vulkan_host_allocator* allocator = user_data;
+    __atomic_fetch_sub(&allocator->stats[scope].internal_allocated, size, __ATOMIC_RELAXED);
+}
+
+b8 vulkan_allocator_create(vulkan_host_allocator* out_allocator)
+{
+    kzero_memory(out_allocator, sizeof(vulkan_host_allocator));
+
+    out_allocator->callbacks.pUserData = out_allocator;
+    out_allocator->callbacks.pfnAllocation = vulkan_host_allocation;
+    out_allocator->callbacks.pfnReallocation = vulkan_host_reallocation;
+    out_allocator->callbacks.pfnFree = vulkan_host_free;
+    out_allocator->callbacks.pfnInternalAllocation = vulkan_host_internal_allocation;
+    out_allocator->callbacks.pfnInternalFree = vulkan_host_internal_free;
+
+    // Never 0, which is what every thread's cached generation starts out as.
+    out_allocator->generation = __atomic_add_fetch(&allocator_generation, 1, __ATOMIC_RELAXED);
+    if (out_allocator->generation == 0)
+        out_allocator->generation = __atomic_add_fetch(&allocator_generation, 1, __ATOMIC_RELAXED);
+
+    return TRUE;
+}
+
+void vulkan_allocator_destroy(vulkan_host_allocator* allocator)
+{
+    for (u32 i = 0; i < VULKAN_ALLOCATION_SCOPE_COUNT; ++i) {
+        const vulkan_host_allocation_stats* stats = &allocator->stats[i];
+        KDEBUG("Vulkan host allocations, %s scope: %llu allocations (%llu from arenas), %llu reallocations, peak %lluB, %lluB still live.",
+            scope_names[i], stats->allocation_count, stats->arena_allocation_count, stats->reallocation_count, stats->peak_allocated, stats->allocated);
+    }
+
+    u32 arena_count = allocator->arena_count < VULKAN_MAX_COMMAND_ARENAS ? allocator->arena_count : VULKAN_MAX_COMMAND_ARENAS;
+    for (u32 i = 0; i < arena_count; ++i) {
+        vulkan_command_arena* arena = &allocator->arenas[i];
+        if (arena->memory) {
+            if (arena->live_count)
+                KWARN("Vulkan command arena destroyed with %llu allocations still live.", arena->live_count);
+            kfree_aligned(arena->memory, arena->size, 64, MEMORY_TAG_RENDERER);
+        }
+    }
+
+    kzero_memory(allocator, sizeof(vulkan_host_allocator));
+}
+
+void vulkan_allocator_get_stats(const vulkan_host_allocator* allocator, VkSystemAllocationScope scope, vulkan_host_allocation_stats* out_stats)
+{
+    const vulkan_host_allocation_stats* stats = &allocator->stats[scope];
+    out_stats->allocated = __atomic_load_n(&stats->allocated, __ATOMIC_RELAXED);
+    out_stats->peak_allocated = __atomic_load_n(&stats->peak_allocated, __ATOMIC_RELAXED);
+    out_stats->allocation_count = __atomic_load_n(&stats->allocation_count, __ATOMIC_RELAXED);
+    out_stats->reallocation_count = __atomic_load_n(&stats->reallocation_count, __ATOMIC_RELAXED);
+    out_stats->arena_allocation_count = __atomic_load_n(&stats->arena_allocation_count, __ATOMIC_RELAXED);
+    out_stats->internal_allocated = __atomic_load_n(&stats->internal_allocated, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "vulkan_types.inl"
+
+// Set to 0 to let the driver use its own host allocator, e.g. when chasing a driver issue.
+#define VULKAN_HOST_ALLOCATOR_ENABLED 1
+
+// The size of each per-thread command scope arena.
+#define VULKAN_COMMAND_ARENA_SIZE KIBIBYTES(64)
+
+/**
+ * Sets up allocation callbacks that route every host allocation the driver makes through kmemory,
+ * under MEMORY_TAG_RENDERER, and keeps per-scope stats. Command scope allocations are served from
+ * small per-thread arenas where possible.
+ * @param out_allocator A pointer to hold the allocator. Must stay at the same address while in use.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+b8 vulkan_allocator_create(vulkan_host_allocator* out_allocator);
+
+/**
+ * Logs the allocator's stats and frees its arenas. Must only be called once every Vulkan object
+ * created with it has been destroyed.
+ * @param allocator A pointer to the allocator to destroy.
+ */
+void vulkan_allocator_destroy(vulkan_host_allocator* allocator);
+
+/**
+ * Copies the current stats of a single allocation scope.
+ * @param allocator A pointer to the allocator.
+ * @param scope The scope to query.
+ * @param out_stats A pointer to hold the stats.
+ */
+void vulkan_allocator_get_stats(const vulkan_host_allocator* allocator, VkSystemAllocationScope scope, vulkan_host_allocation_stats* out_stats);
@@ -1,7 +1,9 @@
 #include "vulkan_backend.h"
 #include "vulkan_platform.h"
 
+#include "vulkan_allocator.h"
 #include "vulkan_device.h"
+#include "vulkan_memory_allocator.h"
 #include "vulkan_types.inl"
 
 #include "core/kstring.h"
@@ -21,8 +23,15 @@ i32 find_memory_index(u32 type_filter, u32 property_flags);
 
 b8 vulkan_renderer_backend_initialize(renderer_backend* backend, const char* application_name, struct platform_state* plat_state)
 {
-    // TODO: custom allocator
+    context.find_memory_index = find_memory_index;
+
     context.allocator = 0;
+#if VULKAN_HOST_ALLOCATOR_ENABLED
+    if (vulkan_allocator_create(&context.host_allocator))
+        context.allocator = &context.host_allocator.callbacks;
+    else
+        KWARN("Failed to create the Vulkan host allocator, falling back to the driver's own.");
+#endif
 
     // Setup Vulkan instance.
     VkApplicationInfo app_info = {
@@ -135,6 +144,11 @@ b8 vulkan_renderer_backend_initialize(renderer_backend* backend, const char* app
         return FALSE;
     }
 
+    if (!vulkan_memory_allocator_create(&context, 0, &context.memory_allocator)) {
+        KERROR("Failed to create device memory allocator!");
+        return FALSE;
+    }
+
     KINFO("Vulkan renderer initialized successfully.");
 
     darray_destroy(required_extensions);
@@ -147,6 +161,9 @@ b8 vulkan_renderer_backend_initialize(renderer_backend* backend, const char* app
 void vulkan_renderer_backend_shutdown(renderer_backend* backend)
 {
     // Destroy in the opposite order of creation
+    KDEBUG("Destroying Vulkan memory allocator...");
+    vulkan_memory_allocator_destroy(&context, &context.memory_allocator);
+
     KDEBUG("Destroying Vulkan device...");
     vulkan_device_destroy(&context);
 
@@ -166,6 +183,11 @@ void vulkan_renderer_backend_shutdown(renderer_backend* backend)
 
     KDEBUG("Destroying Vulkan instance...");
     vkDestroyInstance(context.instance, context.allocator);
+
+    if (context.allocator) {
+        vulkan_allocator_destroy(&context.host_allocator);
+        context.allocator = 0;
+    }
 }
 
 void vulkan_renderer_backend_on_resized(renderer_backend* backend, u16 width, u16 height)
@@ -208,16 +230,5 @@ VKAPI_ATTR VkBool32 VKAPI_CALL vk_debug_callback(
 
 i32 find_memory_index(u32 type_filter, u32 property_flags)
 {
-    VkPhysicalDeviceMemoryProperties memory_properties;
-    vkGetPhysicalDeviceMemoryProperties(context.device.physical_device, &memory_properties);
-
-    for (u32 i = 0; i < memory_properties.memoryTypeCount; ++i) {
-        // Check each memory type to see if its bit is set to 1.
-        if (type_filter & (1 << i) && (memory_properties.memoryTypes[i].propertyFlags & property_flags)) {
-            return i;
-        }
-    }
-
-    KWARN("Unable to find suitable memory type!");
-    return -1;
+    return vulkan_device_find_memory_index(&context.device, type_filter, property_flags);
 }
@@ -40,6 +40,8 @@ static b8 queue_requirements_match(
 
 static b8 extension_requirements_match(VkPhysicalDevice device, const vulkan_physical_device_requirements* requirements);
 
+static void build_memory_type_tables(vulkan_device* device);
+
 static b8 swapchain_requirements_match(
     VkPhysicalDevice device,
     VkSurfaceKHR surface,
@@ -297,6 +299,7 @@ static b8 select_physical_device(vulkan_context* context)
         context->device.properties = properties;
         context->device.features = features;
         context->device.memory = memory;
+        build_memory_type_tables(&context->device);
         break; // If control reaches this point we've found a physical device
     }
 
@@ -392,7 +395,7 @@ void vulkan_device_query_swapchain_support(
 
     if (out_support_info->format_count != 0) {
         if (!out_support_info->formats) {
-            out_support_info->formats = kallocate(sizeof(VkSurfaceFormatKHR) * out_support_info->format_count, MEMORY_TAG_RENDERER);
+            out_support_info->formats = kallocate_uninitialized(sizeof(VkSurfaceFormatKHR) * out_support_info->format_count, MEMORY_TAG_RENDERER);
         }
         VK_CHECK(vkGetPhysicalDeviceSurfaceFormatsKHR(
             physical_device,
@@ -405,7 +408,7 @@ void vulkan_device_query_swapchain_support(
 
     if (out_support_info->present_mode_count != 0) {
         if (!out_support_info->present_modes) {
-            out_support_info->present_modes = kallocate(sizeof(VkPresentModeKHR) * out_support_info->present_mode_count, MEMORY_TAG_RENDERER);
+            out_support_info->present_modes = kallocate_uninitialized(sizeof(VkPresentModeKHR) * out_support_info->present_mode_count, MEMORY_TAG_RENDERER);
         }
 
         VK_CHECK(
@@ -538,7 +541,7 @@ static b8 extension_requirements_match(
             0));
 
         if (available_extension_count != 0) {
-            available_extensions = kallocate(sizeof(VkExtensionProperties) * available_extension_count, MEMORY_TAG_RENDERER);
+            available_extensions = kallocate_uninitialized(sizeof(VkExtensionProperties) * available_extension_count, MEMORY_TAG_RENDERER);
 
             VK_CHECK(vkEnumerateDeviceExtensionProperties(
                 device,
@@ -595,3 +598,73 @@ static b8 swapchain_requirements_match(
 
     return TRUE;
 }
+
+// The memory types having every one of the required flags and none of the excluded ones.
+static u32 memory_types_matching(const vulkan_device* device, VkMemoryPropertyFlags required, VkMemoryPropertyFlags excluded)
+{
+    u32 mask = 0;
+    for (u32 i = 0; i < device->memory.memoryTypeCount; ++i) {
+        VkMemoryPropertyFlags flags = device->memory.memoryTypes[i].propertyFlags;
+        if ((flags & required) == required && !(flags & excluded))
+            mask |= 1u << i;
+    }
+    return mask;
+}
+
+static void build_memory_type_tables(vulkan_device* device)
+{
+    for (u32 flags = 0; flags < VULKAN_MEMORY_FLAG_COMBINATIONS; ++flags)
+        device->memory_type_masks[flags] = memory_types_matching(device, flags, 0);
+
+    const VkMemoryPropertyFlags device_local = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    const VkMemoryPropertyFlags host_visible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    const VkMemoryPropertyFlags host_coherent = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    const VkMemoryPropertyFlags host_cached = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    const VkMemoryPropertyFlags lazily_allocated = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+
+    // Memory the CPU cannot see is the fastest for the GPU on discrete cards. Integrated ones only have
+    // device local memory that is also host visible, which still qualifies.
+    device->memory_usage_preferred_masks[VULKAN_MEMORY_USAGE_DEVICE_LOCAL] = memory_types_matching(device, device_local, host_visible | lazily_allocated);
+    device->memory_usage_acceptable_masks[VULKAN_MEMORY_USAGE_DEVICE_LOCAL] = memory_types_matching(device, device_local, lazily_allocated);
+
+    // Uncached, coherent memory is write combined, which suits streaming writes and needs no flushing.
+    device->memory_usage_preferred_masks[VULKAN_MEMORY_USAGE_UPLOAD] = memory_types_matching(device, host_visible | host_coherent, host_cached);
+    device->memory_usage_acceptable_masks[VULKAN_MEMORY_USAGE_UPLOAD] = memory_types_matching(device, host_visible, 0);
+
+    // Reading uncached memory from the CPU is painfully slow.
+    device->memory_usage_preferred_masks[VULKAN_MEMORY_USAGE_READBACK] = memory_types_matching(device, host_visible | host_cached, 0);
+    device->memory_usage_acceptable_masks[VULKAN_MEMORY_USAGE_READBACK] = memory_types_matching(device, host_visible, 0);
+
+    device->memory_usage_preferred_masks[VULKAN_MEMORY_USAGE_LAZILY_ALLOCATED] = memory_types_matching(device, device_local | lazily_allocated, 0);
+    device->memory_usage_acceptable_masks[VULKAN_MEMORY_USAGE_LAZILY_ALLOCATED] = memory_types_matching(device, device_local, 0);
+}
+
+i32 vulkan_device_find_memory_index(const vulkan_device* device, u32 type_filter, VkMemoryPropertyFlags property_flags)
+{
+    u32 candidates;
+    if (property_flags < VULKAN_MEMORY_FLAG_COMBINATIONS) {
+        candidates = type_filter & device->memory_type_masks[property_flags];
+    } else {
+        // Vendor specific flags are rare enough to look up the slow way.
+        candidates = type_filter & memory_types_matching(device, property_flags, 0);
+    }
+
+    if (!candidates) {
+        KWARN("Unable to find suitable memory type!");
+        return -1;
+    }
+    return __builtin_ctz(candidates);
+}
+
+i32 vulkan_device_find_memory_index_for_usage(const vulkan_device* device, u32 type_filter, vulkan_memory_usage usage)
+{
+    u32 candidates = type_filter & device->memory_usage_preferred_masks[usage];
+    if (!candidates)
+        candidates = type_filter & device->memory_usage_acceptable_masks[usage];
+
+    if (!candidates) {
+        KWARN("Unable to find a memory type suitable for usage %u!", usage);
+        return -1;
+    }
+    return __builtin_ctz(candidates);
+}
@@ -11,3 +11,23 @@ void vulkan_device_query_swapchain_support(
     vulkan_swapchain_support_info* out_support_info);
 
 b8 vulkan_device_detect_depth_format(vulkan_device* context);
+
+/**
+ * Finds the first memory type allowed by the filter that has every requested property. Memory
+ * types are ordered by the driver from most to least performant, so the first match is the best.
+ * Answered from tables built at device selection, without querying the driver.
+ * @param device A pointer to the device.
+ * @param type_filter A bitmask of allowed memory types, from VkMemoryRequirements.
+ * @param property_flags The properties the memory type must have.
+ * @returns The memory type index, or -1 if none matches.
+ */
+i32 vulkan_device_find_memory_index(const vulkan_device* device, u32 type_filter, VkMemoryPropertyFlags property_flags);
+
+/**
+ * Finds the best memory type allowed by the filter for the given usage.
+ * @param device A pointer to the device.
+ * @param type_filter A bitmask of allowed memory types, from VkMemoryRequirements.
+ * @param usage What the memory is used for.
+ * @returns The memory type index, or -1 if none is suitable.
+ */
+i32 vulkan_device_find_memory_index_for_usage(const vulkan_device* device, u32 type_filter, vulkan_memory_usage usage);
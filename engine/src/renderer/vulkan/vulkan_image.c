@@ -1,11 +1,12 @@
 #include "vulkan_image.h"
 
 #include "vulkan_device.h"
+#include "vulkan_memory_allocator.h"
 
 #include "core/kmemory.h"
 #include "core/logger.h"
 
-void vulkan_image_create(
+b8 vulkan_image_create(
     vulkan_context* context,
     VkImageType image_type,
     u32 width,
@@ -13,7 +14,7 @@ void vulkan_image_create(
     VkFormat format,
     VkImageTiling tiling,
     VkImageUsageFlags usage,
-    VkMemoryPropertyFlags memory_flags,
+    vulkan_memory_usage memory_usage,
     b32 create_view,
     VkImageAspectFlags view_aspect_flags,
     vulkan_image* out_image)
@@ -46,26 +47,22 @@ void vulkan_image_create(
     VkMemoryRequirements memory_requirements;
     vkGetImageMemoryRequirements(context->device.logical_device, out_image->handle, &memory_requirements);
 
-    i32 memory_type = context->find_memory_index(memory_requirements.memoryTypeBits, memory_flags);
-
-    if (memory_type == -1)
-        KERROR("Required memory type not found. Image not valid");
-
-    // Allocate memory
-    VkMemoryAllocateInfo memory_allocate_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .memoryTypeIndex = memory_type
-    };
-
-    VK_CHECK(vkAllocateMemory(context->device.logical_device, &memory_allocate_info, context->allocator, &out_image->memory));
+    vulkan_memory_kind kind = tiling == VK_IMAGE_TILING_OPTIMAL ? VULKAN_MEMORY_KIND_OPTIMAL : VULKAN_MEMORY_KIND_LINEAR;
+    out_image->view = 0;
+    if (!vulkan_memory_allocate(context, &memory_requirements, memory_usage, kind, &out_image->memory)) {
+        KERROR("Failed to allocate memory for image.");
+        vkDestroyImage(context->device.logical_device, out_image->handle, context->allocator);
+        out_image->handle = 0;
+        return FALSE;
+    }
 
-    VK_CHECK(vkBindImageMemory(context->device.logical_device, out_image->handle, out_image->memory, 0)); // TODO: Configurable memory offset
+    VK_CHECK(vkBindImageMemory(context->device.logical_device, out_image->handle, out_image->memory.memory, out_image->memory.offset));
 
     // Create view
     if (create_view) {
-        out_image->view = 0;
         vulkan_image_view_create(context, format, out_image, view_aspect_flags);
     }
+    return TRUE;
 }
 
 void vulkan_image_view_create(vulkan_context* context, VkFormat format, vulkan_image* image, VkImageAspectFlags aspect_flags)
@@ -93,10 +90,8 @@ void vulkan_image_destroy(vulkan_context* context, vulkan_image* image)
         image->view = 0;
     }
 
-    if (image->memory) {
-        vkFreeMemory(context->device.logical_device, image->memory, context->allocator);
-        image->memory = 0;
-    }
+    if (image->memory.block)
+        vulkan_memory_free(context, &image->memory);
 
     if (image->handle) {
         vkDestroyImage(context->device.logical_device, image->handle, context->allocator);
@@ -2,7 +2,11 @@
 
 #include "vulkan_types.inl"
 
-void vulkan_image_create(
+/**
+ * Creates an image and binds device memory to it.
+ * @returns TRUE on success; otherwise FALSE, leaving no image behind.
+ */
+b8 vulkan_image_create(
     vulkan_context* context,
     VkImageType image_type,
     u32 width,
@@ -10,7 +14,7 @@ void vulkan_image_create(
     VkFormat format,
     VkImageTiling tiling,
     VkImageUsageFlags usage,
-    VkMemoryPropertyFlags memory_flags,
+    vulkan_memory_usage memory_usage,
     b32 create_view,
     VkImageAspectFlags view_aspect_flags,
     vulkan_image* out_image);
@@ -0,0 +1,392 @@
+#include "vulkan_memory_allocator.h"
+
+#include "vulkan_device.h"
+
+#include "core/kmemory.h"
+#include "core/logger.h"
+
+static VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static b8 free_ranges_reserve(vulkan_memory_block* block, u32 count)
+{
+    if (count <= block->free_range_capacity)
+        return TRUE;
+
+    u32 capacity = block->free_range_capacity ? block->free_range_capacity * 2 : 8;
+    vulkan_memory_range* ranges = kallocate_uninitialized(sizeof(vulkan_memory_range) * capacity, MEMORY_TAG_RENDERER);
+    if (!ranges)
+        return FALSE;
+
+    if (block->free_ranges) {
+        kcopy_memory(ranges, block->free_ranges, sizeof(vulkan_memory_range) * block->free_range_count);
+        kfree(block->free_ranges, sizeof(vulkan_memory_range) * block->free_range_capacity, MEMORY_TAG_RENDERER);
+    }
+
+    block->free_ranges = ranges;
+    block->free_range_capacity = capacity;
+    return TRUE;
+}
+
+// Inserts a range at index. Room must have been reserved.
+static void free_ranges_insert(vulkan_memory_block* block, u32 index, VkDeviceSize offset, VkDeviceSize size)
+{
+    for (u32 i = block->free_range_count; i > index; --i)
+        block->free_ranges[i] = block->free_ranges[i - 1];
+
+    block->free_ranges[index].offset = offset;
+    block->free_ranges[index].size = size;
+    block->free_range_count++;
+}
+
+static void free_ranges_remove(vulkan_memory_block* block, u32 index)
+{
+    for (u32 i = index; i + 1 < block->free_range_count; ++i)
+        block->free_ranges[i] = block->free_ranges[i + 1];
+    block->free_range_count--;
+}
+
+static vulkan_memory_block* block_create(vulkan_context* context, u32 memory_type_index, VkDeviceSize size, b8 dedicated)
+{
+    vulkan_memory_allocator* allocator = &context->memory_allocator;
+
+    if (allocator->device_allocation_count >= context->device.properties.limits.maxMemoryAllocationCount) {
+        KERROR("Unable to allocate device memory, maxMemoryAllocationCount (%u) reached.", context->device.properties.limits.maxMemoryAllocationCount);
+        return 0;
+    }
+
+    VkMemoryAllocateInfo allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = size,
+        .memoryTypeIndex = memory_type_index
+    };
+
+    VkDeviceMemory memory;
+    VkResult result = allocator->functions.allocate(context->device.logical_device, &allocate_info, context->allocator, &memory);
+    if (result != VK_SUCCESS) {
+        KERROR("vkAllocateMemory failed allocating %llu bytes from memory type %u.", size, memory_type_index);
+        return 0;
+    }
+
+    vulkan_memory_block* block = pool_allocate(&allocator->block_pool, vulkan_memory_block);
+    if (!block || !free_ranges_reserve(block, 1)) {
+        if (block)
+            pool_free(&allocator->block_pool, block);
+        allocator->functions.free(context->device.logical_device, memory, context->allocator);
+        return 0;
+    }
+
+    block->memory = memory;
+    block->size = size;
+    block->dedicated = dedicated;
+    free_ranges_insert(block, 0, 0, size);
+
+    // Host visible blocks stay mapped for their whole life, mapping is not free.
+    if (context->device.memory.memoryTypes[memory_type_index].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        VK_CHECK(allocator->functions.map(context->device.logical_device, memory, 0, VK_WHOLE_SIZE, 0, &block->mapped));
+
+    vulkan_memory_stats* stats = &allocator->stats[memory_type_index];
+    stats->block_count++;
+    stats->reserved += size;
+    if (dedicated)
+        stats->dedicated_block_count++;
+
+    allocator->device_allocation_count++;
+    return block;
+}
+
+static void block_destroy(vulkan_context* context, u32 memory_type_index, vulkan_memory_block* block)
+{
+    vulkan_memory_allocator* allocator = &context->memory_allocator;
+
+    if (block->mapped)
+        allocator->functions.unmap(context->device.logical_device, block->memory);
+    allocator->functions.free(context->device.logical_device, block->memory, context->allocator);
+
+    vulkan_memory_stats* stats = &allocator->stats[memory_type_index];
+    stats->block_count--;
+    stats->reserved -= block->size;
+    if (block->dedicated)
+        stats->dedicated_block_count--;
+
+    allocator->device_allocation_count--;
+
+    kfree(block->free_ranges, sizeof(vulkan_memory_range) * block->free_range_capacity, MEMORY_TAG_RENDERER);
+    pool_free(&allocator->block_pool, block);
+}
+
+// Carves size bytes out of the free range that leaves the least behind. Leading padding stays free.
+static b8 block_allocate(vulkan_memory_block* block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* out_offset)
+{
+    u32 best = block->free_range_count;
+    VkDeviceSize best_leftover = ~0ULL;
+
+    for (u32 i = 0; i < block->free_range_count; ++i) {
+        const vulkan_memory_range* range = &block->free_ranges[i];
+        VkDeviceSize offset = align_up(range->offset, alignment);
+        if (offset + size > range->offset + range->size)
+            continue;
+
+        VkDeviceSize leftover = range->size - size;
+        if (leftover < best_leftover) {
+            best = i;
+            best_leftover = leftover;
+            if (leftover == 0)
+                break;
+        }
+    }
+
+    if (best == block->free_range_count)
+        return FALSE;
+
+    vulkan_memory_range range = block->free_ranges[best];
+    VkDeviceSize offset = align_up(range.offset, alignment);
+    VkDeviceSize head = offset - range.offset;
+    VkDeviceSize tail = range.offset + range.size - (offset + size);
+
+    if (head && tail) {
+        if (!free_ranges_reserve(block, block->free_range_count + 1))
+            return FALSE;
+        block->free_ranges[best].size = head;
+        free_ranges_insert(block, best + 1, offset + size, tail);
+    } else if (head) {
+        block->free_ranges[best].size = head;
+    } else if (tail) {
+        block->free_ranges[best].offset = offset + size;
+        block->free_ranges[best].size = tail;
+    } else {
+        free_ranges_remove(block, best);
+    }
+
+    block->used += size;
+    block->allocation_count++;
+    *out_offset = offset;
+    return TRUE;
+}
+
+// Returns a range to the block, merging it with its free neighbours.
+static void block_free(vulkan_memory_block* block, VkDeviceSize offset, VkDeviceSize size)
+{
+    // Find the first free range past the one being freed.
+    u32 low = 0;
+    u32 high = block->free_range_count;
+    while (low < high) {
+        u32 mid = (low + high) / 2;
+        if (block->free_ranges[mid].offset < offset)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    vulkan_memory_range* previous = low > 0 ? &block->free_ranges[low - 1] : 0;
+    vulkan_memory_range* next = low < block->free_range_count ? &block->free_ranges[low] : 0;
+    b8 merge_previous = previous && previous->offset + previous->size == offset;
+    b8 merge_next = next && offset + size == next->offset;
+
+    if (merge_previous && merge_next) {
+        previous->size += size + next->size;
+        free_ranges_remove(block, low);
+    } else if (merge_previous) {
+        previous->size += size;
+    } else if (merge_next) {
+        next->offset = offset;
+        next->size += size;
+    } else if (free_ranges_reserve(block, block->free_range_count + 1)) {
+        free_ranges_insert(block, low, offset, size);
+    } else {
+        KERROR("Unable to grow a device memory free list, %llu bytes are lost until the block is released.", size);
+    }
+
+    block->used -= size;
+    block->allocation_count--;
+}
+
+// Unlinks a block from its list and releases it.
+static void block_release(vulkan_context* context, u32 memory_type_index, vulkan_memory_kind kind, vulkan_memory_block* block)
+{
+    vulkan_memory_block** link = &context->memory_allocator.blocks[memory_type_index][kind];
+    while (*link != block)
+        link = &(*link)->next;
+    *link = block->next;
+
+    block_destroy(context, memory_type_index, block);
+}
+
+b8 vulkan_memory_allocator_create(vulkan_context* context, const vulkan_memory_functions* functions, vulkan_memory_allocator* out_allocator)
+{
+    kzero_memory(out_allocator, sizeof(vulkan_memory_allocator));
+
+    if (functions) {
+        out_allocator->functions = *functions;
+    } else {
+        out_allocator->functions.allocate = vkAllocateMemory;
+        out_allocator->functions.free = vkFreeMemory;
+        out_allocator->functions.map = vkMapMemory;
+        out_allocator->functions.unmap = vkUnmapMemory;
+    }
+
+    if (!pool_allocator_create_typed(vulkan_memory_block, 64, MEMORY_TAG_RENDERER, &out_allocator->block_pool)) {
+        KERROR("Unable to create the device memory block pool.");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void vulkan_memory_allocator_destroy(vulkan_context* context, vulkan_memory_allocator* allocator)
+{
+    for (u32 type = 0; type < VK_MAX_MEMORY_TYPES; ++type) {
+        const vulkan_memory_stats* stats = &allocator->stats[type];
+        if (stats->allocation_count) {
+            KWARN("Device memory type %u destroyed with %u allocations (%llu bytes) still live.", type, stats->allocation_count, stats->used);
+        }
+
+        for (u32 kind = 0; kind < VULKAN_MEMORY_KIND_MAX; ++kind) {
+            vulkan_memory_block* block = allocator->blocks[type][kind];
+            while (block) {
+                vulkan_memory_block* next = block->next;
+                block_destroy(context, type, block);
+                block = next;
+            }
+            allocator->blocks[type][kind] = 0;
+        }
+    }
+
+    pool_allocator_destroy(&allocator->block_pool);
+    kzero_memory(allocator, sizeof(vulkan_memory_allocator));
+}
+
+b8 vulkan_memory_allocate(
+    vulkan_context* context,
+    const VkMemoryRequirements* requirements,
+    vulkan_memory_usage usage,
+    vulkan_memory_kind kind,
+    vulkan_allocation* out_allocation)
+{
+    vulkan_memory_allocator* allocator = &context->memory_allocator;
+    kzero_memory(out_allocation, sizeof(vulkan_allocation));
+
+    i32 memory_type_index = vulkan_device_find_memory_index_for_usage(&context->device, requirements->memoryTypeBits, usage);
+    if (memory_type_index == -1)
+        return FALSE;
+
+    const VkPhysicalDeviceLimits* limits = &context->device.properties.limits;
+    const VkMemoryType* memory_type = &context->device.memory.memoryTypes[memory_type_index];
+
+    // Without a granularity to respect, linear and optimal resources can share blocks.
+    if (limits->bufferImageGranularity <= 1)
+        kind = VULKAN_MEMORY_KIND_LINEAR;
+
+    // Mapped ranges of non-coherent memory are flushed in whole atoms, keep them from straddling allocations.
+    VkDeviceSize alignment = requirements->alignment ? requirements->alignment : 1;
+    if ((memory_type->propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(memory_type->propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+        && limits->nonCoherentAtomSize > alignment)
+        alignment = limits->nonCoherentAtomSize;
+
+    VkDeviceSize block_size = VULKAN_MEMORY_BLOCK_SIZE;
+    VkDeviceSize heap_size = context->device.memory.memoryHeaps[memory_type->heapIndex].size;
+    if (heap_size / 8 < block_size)
+        block_size = heap_size / 8;
+
+    vulkan_memory_block* block = 0;
+    VkDeviceSize offset = 0;
+
+    if (requirements->size >= block_size / VULKAN_MEMORY_DEDICATED_DIVISOR) {
+        block = block_create(context, memory_type_index, requirements->size, TRUE);
+        if (!block || !block_allocate(block, requirements->size, 1, &offset)) {
+            if (block)
+                block_destroy(context, memory_type_index, block);
+            return FALSE;
+        }
+        block->next = allocator->blocks[memory_type_index][kind];
+        allocator->blocks[memory_type_index][kind] = block;
+    } else {
+        for (block = allocator->blocks[memory_type_index][kind]; block; block = block->next) {
+            if (!block->dedicated && block->size - block->used >= requirements->size
+                && block_allocate(block, requirements->size, alignment, &offset))
+                break;
+        }
+
+        if (!block) {
+            block = block_create(context, memory_type_index, block_size, FALSE);
+            if (!block)
+                return FALSE;
+            block->next = allocator->blocks[memory_type_index][kind];
+            allocator->blocks[memory_type_index][kind] = block;
+
+            if (!block_allocate(block, requirements->size, alignment, &offset))
+                return FALSE;
+        }
+    }
+
+    vulkan_memory_stats* stats = &allocator->stats[memory_type_index];
+    stats->allocation_count++;
+    stats->used += requirements->size;
+
+    out_allocation->memory = block->memory;
+    out_allocation->offset = offset;
+    out_allocation->size = requirements->size;
+    out_allocation->mapped = block->mapped ? (u8*)block->mapped + offset : 0;
+    out_allocation->block = block;
+    out_allocation->memory_type_index = memory_type_index;
+    out_allocation->kind = kind;
+    return TRUE;
+}
+
+void vulkan_memory_free(vulkan_context* context, vulkan_allocation* allocation)
+{
+    vulkan_memory_block* block = allocation->block;
+    if (!block)
+        return;
+
+    u32 type = allocation->memory_type_index;
+    block_free(block, allocation->offset, allocation->size);
+
+    vulkan_memory_stats* stats = &context->memory_allocator.stats[type];
+    stats->allocation_count--;
+    stats->used -= allocation->size;
+
+    if (block->allocation_count == 0) {
+        // Keep a single empty block around, so a resource freed and created every frame does not hit the driver each time.
+        b8 release = block->dedicated;
+        for (vulkan_memory_block* other = context->memory_allocator.blocks[type][allocation->kind]; other && !release; other = other->next) {
+            if (other != block && !other->dedicated && other->allocation_count == 0)
+                release = TRUE;
+        }
+
+        if (release)
+            block_release(context, type, allocation->kind, block);
+    }
+
+    kzero_memory(allocation, sizeof(vulkan_allocation));
+}
+
+u32 vulkan_memory_allocator_trim(vulkan_context* context, vulkan_memory_allocator* allocator)
+{
+    u32 released = 0;
+    for (u32 type = 0; type < VK_MAX_MEMORY_TYPES; ++type) {
+        for (u32 kind = 0; kind < VULKAN_MEMORY_KIND_MAX; ++kind) {
+            vulkan_memory_block* block = allocator->blocks[type][kind];
+            while (block) {
+                vulkan_memory_block* next = block->next;
+                if (block->allocation_count == 0) {
+                    block_release(context, type, kind, block);
+                    released++;
+                }
+                block = next;
+            }
+        }
+    }
+    return released;
+}
+
+void vulkan_memory_allocator_get_stats(const vulkan_memory_allocator* allocator, u32 memory_type_index, vulkan_memory_stats* out_stats)
+{
+    if (memory_type_index >= VK_MAX_MEMORY_TYPES) {
+        kzero_memory(out_stats, sizeof(vulkan_memory_stats));
+        return;
+    }
+    *out_stats = allocator->stats[memory_type_index];
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "vulkan_types.inl"
+
+// The size of a shared device memory block. Capped to a fraction of the heap on small heaps.
+#define VULKAN_MEMORY_BLOCK_SIZE MEBIBYTES(64)
+
+// Resources at least this fraction of a block get a dedicated block of their own.
+#define VULKAN_MEMORY_DEDICATED_DIVISOR 2
+
+/**
+ * Sets up the device memory allocator. Memory is allocated from the driver in large blocks per
+ * memory type, which are then sub-allocated, keeping well clear of maxMemoryAllocationCount.
+ * Not thread safe, like the rest of the renderer. The allocator functions are exported so the
+ * tests can run them against a fake driver.
+ * @param context A pointer to the context, whose logical device must already exist.
+ * @param functions The driver entry points to use, or 0/NULL for the Vulkan loader's own.
+ * @param out_allocator A pointer to hold the allocator.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 vulkan_memory_allocator_create(vulkan_context* context, const vulkan_memory_functions* functions, vulkan_memory_allocator* out_allocator);
+
+/**
+ * Releases every block back to the driver. Allocations still live become invalid.
+ * @param context A pointer to the context.
+ * @param allocator A pointer to the allocator to destroy.
+ */
+KAPI void vulkan_memory_allocator_destroy(vulkan_context* context, vulkan_memory_allocator* allocator);
+
+/**
+ * Allocates device memory for a resource.
+ * @param context A pointer to the context.
+ * @param requirements The resource's memory requirements.
+ * @param usage What the memory is used for, which picks the memory type.
+ * @param kind Whether the resource is linear or an optimal tiling image.
+ * @param out_allocation A pointer to hold the allocation.
+ * @returns TRUE on success; otherwise FALSE.
+ */
+KAPI b8 vulkan_memory_allocate(
+    vulkan_context* context,
+    const VkMemoryRequirements* requirements,
+    vulkan_memory_usage usage,
+    vulkan_memory_kind kind,
+    vulkan_allocation* out_allocation);
+
+/**
+ * Frees an allocation made with vulkan_memory_allocate. Its range is merged back into the block
+ * it came from, and a block left empty is released unless it is the only empty one of its kind.
+ * @param context A pointer to the context.
+ * @param allocation A pointer to the allocation to free.
+ */
+KAPI void vulkan_memory_free(vulkan_context* context, vulkan_allocation* allocation);
+
+/**
+ * Releases every empty block back to the driver, e.g. after a level is unloaded.
+ * @param context A pointer to the context.
+ * @param allocator A pointer to the allocator.
+ * @returns The number of blocks released.
+ */
+KAPI u32 vulkan_memory_allocator_trim(vulkan_context* context, vulkan_memory_allocator* allocator);
+
+/**
+ * Gets the stats of a single memory type.
+ * @param allocator A pointer to the allocator.
+ * @param memory_type_index The memory type to query.
+ * @param out_stats A pointer to hold the stats.
+ */
+KAPI void vulkan_memory_allocator_get_stats(const vulkan_memory_allocator* allocator, u32 memory_type_index, vulkan_memory_stats* out_stats);
@@ -190,11 +190,11 @@ static void create(vulkan_context* context, u32 width, u32 height, vulkan_swapch
     swapchain->image_count = 0;
     VK_CHECK(vkGetSwapchainImagesKHR(context->device.logical_device, swapchain->handle, &swapchain->image_count, 0));
     if (!swapchain->images) {
-        swapchain->images = (VkImage*)kallocate(sizeof(VkImage) * swapchain->image_count, MEMORY_TAG_RENDERER);
+        swapchain->images = (VkImage*)kallocate_uninitialized(sizeof(VkImage) * swapchain->image_count, MEMORY_TAG_RENDERER);
     }
 
     if (!swapchain->views) {
-        swapchain->views = (VkImageView*)kallocate(sizeof(VkImageView) * swapchain->image_count, MEMORY_TAG_RENDERER);
+        swapchain->views = (VkImageView*)kallocate_uninitialized(sizeof(VkImageView) * swapchain->image_count, MEMORY_TAG_RENDERER);
     }
 
     VK_CHECK(vkGetSwapchainImagesKHR(context->device.logical_device, swapchain->handle, &swapchain->image_count, swapchain->images));
@@ -223,18 +223,20 @@ static void create(vulkan_context* context, u32 width, u32 height, vulkan_swapch
     }
 
     // Create depth image and its view
-    vulkan_image_create(
-        context,
-        VK_IMAGE_TYPE_2D,
-        swapchain_extent.width,
-        swapchain_extent.height,
-        context->device.depth_format,
-        VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        TRUE,
-        VK_IMAGE_ASPECT_DEPTH_BIT,
-        &swapchain->depth_attachment);
+    if (!vulkan_image_create(
+            context,
+            VK_IMAGE_TYPE_2D,
+            swapchain_extent.width,
+            swapchain_extent.height,
+            context->device.depth_format,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+            VULKAN_MEMORY_USAGE_DEVICE_LOCAL,
+            TRUE,
+            VK_IMAGE_ASPECT_DEPTH_BIT,
+            &swapchain->depth_attachment)) {
+        KFATAL("Failed to create the depth attachment.");
+    }
 
     KINFO("Swapchain created successfully.");
 }
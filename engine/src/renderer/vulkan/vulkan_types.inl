@@ -3,6 +3,7 @@
 #include "defines.h"
 
 #include "core/asserts.h"
+#include "core/pool_allocator.h"
 
 #include <vulkan/vulkan.h>
 
@@ -19,6 +20,106 @@ typedef struct vulkan_swapchain_support_info {
     VkPresentModeKHR* present_modes;
 } vulkan_swapchain_support_info;
 
+/**
+ * What a device memory block holds. Linear and optimal tiling resources are kept in separate blocks,
+ * so they never end up within bufferImageGranularity of each other.
+ */
+typedef enum vulkan_memory_kind {
+    // Buffers and linear tiling images.
+    VULKAN_MEMORY_KIND_LINEAR,
+    // Optimal tiling images.
+    VULKAN_MEMORY_KIND_OPTIMAL,
+
+    VULKAN_MEMORY_KIND_MAX
+} vulkan_memory_kind;
+
+typedef struct vulkan_memory_range {
+    VkDeviceSize offset;
+    VkDeviceSize size;
+} vulkan_memory_range;
+
+// A single vkAllocateMemory, sub-allocated by the vulkan memory allocator.
+typedef struct vulkan_memory_block {
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    VkDeviceSize used;
+    u32 allocation_count;
+
+    // Free ranges, sorted by offset and never adjacent to one another.
+    vulkan_memory_range* free_ranges;
+    u32 free_range_count;
+    u32 free_range_capacity;
+
+    // Base of the persistent mapping, if the memory is host visible.
+    void* mapped;
+
+    // Holds a single resource too large to share a block.
+    b8 dedicated;
+
+    struct vulkan_memory_block* next;
+} vulkan_memory_block;
+
+// A range of device memory handed out by the vulkan memory allocator.
+typedef struct vulkan_allocation {
+    VkDeviceMemory memory;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    // Points at offset if the memory is host visible; otherwise 0/NULL.
+    void* mapped;
+
+    vulkan_memory_block* block;
+    u32 memory_type_index;
+    vulkan_memory_kind kind;
+} vulkan_allocation;
+
+typedef struct vulkan_memory_stats {
+    u32 block_count;
+    u32 dedicated_block_count;
+    u32 allocation_count;
+    // Bytes allocated from the driver, and how many of those are handed out.
+    u64 reserved;
+    u64 used;
+} vulkan_memory_stats;
+
+// The driver entry points the device memory allocator calls. Tests replace them to run it without a device.
+typedef struct vulkan_memory_functions {
+    PFN_vkAllocateMemory allocate;
+    PFN_vkFreeMemory free;
+    PFN_vkMapMemory map;
+    PFN_vkUnmapMemory unmap;
+} vulkan_memory_functions;
+
+typedef struct vulkan_memory_allocator {
+    vulkan_memory_functions functions;
+
+    // Block lists, indexed by memory type and then kind.
+    vulkan_memory_block* blocks[VK_MAX_MEMORY_TYPES][VULKAN_MEMORY_KIND_MAX];
+    vulkan_memory_stats stats[VK_MAX_MEMORY_TYPES];
+
+    // Block headers.
+    pool_allocator block_pool;
+
+    // The number of live vkAllocateMemory allocations, checked against maxMemoryAllocationCount.
+    u32 device_allocation_count;
+} vulkan_memory_allocator;
+
+// What a resource's memory is used for, each mapped to the best memory type for it at device creation.
+typedef enum vulkan_memory_usage {
+    // Only ever touched by the GPU.
+    VULKAN_MEMORY_USAGE_DEVICE_LOCAL,
+    // Written by the CPU and read by the GPU, e.g. staging buffers.
+    VULKAN_MEMORY_USAGE_UPLOAD,
+    // Written by the GPU and read back by the CPU.
+    VULKAN_MEMORY_USAGE_READBACK,
+    // Transient attachments that may never need backing memory at all.
+    VULKAN_MEMORY_USAGE_LAZILY_ALLOCATED,
+
+    VULKAN_MEMORY_USAGE_MAX
+} vulkan_memory_usage;
+
+// Every combination of the property flags from DEVICE_LOCAL up to PROTECTED.
+#define VULKAN_MEMORY_FLAG_COMBINATIONS 64
+
 typedef struct vulkan_device {
     VkPhysicalDevice physical_device;
     VkDevice logical_device;
@@ -36,12 +137,18 @@ typedef struct vulkan_device {
     VkPhysicalDeviceFeatures features;
     VkPhysicalDeviceMemoryProperties memory;
 
+    // The memory types having every flag in the index, as a bitmask. Built when the device is selected.
+    u32 memory_type_masks[VULKAN_MEMORY_FLAG_COMBINATIONS];
+    // The memory types best suited to each usage, and those that merely work.
+    u32 memory_usage_preferred_masks[VULKAN_MEMORY_USAGE_MAX];
+    u32 memory_usage_acceptable_masks[VULKAN_MEMORY_USAGE_MAX];
+
     VkFormat depth_format;
 } vulkan_device;
 
 typedef struct vulkan_image {
     VkImage handle;
-    VkDeviceMemory memory;
+    vulkan_allocation memory;
     VkImageView view;
     u32 width;
     u32 height;
@@ -58,12 +165,57 @@ typedef struct vulkan_swapchain {
     vulkan_image depth_attachment;
 } vulkan_swapchain;
 
+// VK_SYSTEM_ALLOCATION_SCOPE_COMMAND through VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE.
+#define VULKAN_ALLOCATION_SCOPE_COUNT 5
+
+// The most threads that get their own command scope arena. Any others allocate from kmemory directly.
+#define VULKAN_MAX_COMMAND_ARENAS 16
+
+/**
+ * Bump arena for command scope allocations, which only live for the duration of a single Vulkan
+ * command. Rewinds to the start whenever nothing in it is live.
+ */
+typedef struct vulkan_command_arena {
+    u8* memory;
+    u64 size;
+    u64 offset;
+    // Allocations still live. Atomic, as a driver is not strictly required to free on the allocating thread.
+    u64 live_count;
+} vulkan_command_arena;
+
+// Host allocation counters for a single allocation scope.
+typedef struct vulkan_host_allocation_stats {
+    // Bytes currently allocated through the callbacks, and the most ever allocated at once.
+    u64 allocated;
+    u64 peak_allocated;
+    u64 allocation_count;
+    u64 reallocation_count;
+    // Allocations served by a command arena instead of kmemory.
+    u64 arena_allocation_count;
+    // Bytes the driver allocated on its own and only reported to us.
+    u64 internal_allocated;
+} vulkan_host_allocation_stats;
+
+// Backs every host allocation the driver makes with kmemory.
+typedef struct vulkan_host_allocator {
+    VkAllocationCallbacks callbacks;
+
+    // Indexed by VkSystemAllocationScope.
+    vulkan_host_allocation_stats stats[VULKAN_ALLOCATION_SCOPE_COUNT];
+
+    vulkan_command_arena arenas[VULKAN_MAX_COMMAND_ARENAS];
+    u32 arena_count;
+    // Tells the arenas of one allocator apart from those of an earlier one, see vulkan_allocator.c.
+    u32 generation;
+} vulkan_host_allocator;
+
 typedef struct vulkan_context {
     u32 framebuffer_width;
     u32 framebuffer_height;
 
     VkInstance instance;
     VkAllocationCallbacks* allocator;
+    vulkan_host_allocator host_allocator;
     VkSurfaceKHR surface;
 
 #if defined(_DEBUG)
@@ -72,6 +224,8 @@ typedef struct vulkan_context {
 
     vulkan_device device;
 
+    vulkan_memory_allocator memory_allocator;
+
     vulkan_swapchain swapchain;
     u32 image_index;
     u32 current_frame;
@@ -0,0 +1,20 @@
+rem Build Script for tests
+@echo off
+setlocal enableDelayedExpansion
+
+rem Get a list of all .c files
+for /r %%f in (*.c) do (
+  set cFilenames=!cFilenames! %%f
+)
+
+set assembly=tests
+
+set compilerFlags=-g -Wall -Werror
+set includeFlags=-Isrc -I../engine/src -I%VULKAN_SDK%/Include
+
+set linkerFlags=-L../bin/ -lengine.lib
+
+set defines=-D_DEBUG -DKIMPORT
+
+echo "Building %assembly%%..."
+clang %cFilenames% %compilerFlags% -o ../bin/%assembly%.exe %defines% %includeFlags% %linkerFlags%
@@ -0,0 +1,284 @@
+#include "darray_tests.h"
+
+#include "../expect.h"
+#include "../test_manager.h"
+
+#include <containers/darray.h>
+
+// Wider than a byte and not a power of two, so stride mistakes show up.
+typedef struct test_element {
+    u32 value;
+    u32 check;
+    u32 pad;
+} test_element;
+
+static test_element element(u32 value)
+{
+    test_element e = { value, value * 7 + 1, 0xABCDEF };
+    return e;
+}
+
+// Creates an array holding 0..count-1.
+static test_element* array_of(u32 count)
+{
+    test_element* array = darray_create(test_element);
+    for (u32 i = 0; i < count; ++i)
+        darray_push(array, element(i));
+    return array;
+}
+
+// TRUE if the array holds exactly the given values, with every element intact.
+static b8 array_matches(const test_element* array, const u32* values, u32 count)
+{
+    if (darray_length(array) != count)
+        return FALSE;
+    for (u32 i = 0; i < count; ++i) {
+        test_element expected = element(values[i]);
+        if (array[i].value != expected.value || array[i].check != expected.check || array[i].pad != expected.pad)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static b8 pop_copies_a_whole_element()
+{
+    test_element* array = array_of(5);
+    expect_should_be(sizeof(test_element), darray_stride(array));
+
+    test_element popped = { 0 };
+    darray_pop(array, &popped);
+    expect_should_be(4, popped.value);
+    expect_should_be(element(4).check, popped.check);
+    expect_should_be(element(4).pad, popped.pad);
+
+    // Popping without a destination just drops the element.
+    darray_pop(array, 0);
+    u32 expected[] = { 0, 1, 2 };
+    expect_to_be_true(array_matches(array, expected, 3));
+
+    darray_destroy(array);
+    return TRUE;
+}
+
+static b8 pop_at_front_middle_and_end()
+{
+    test_element* array = array_of(6);
+    test_element popped = { 0 };
+
+    darray_pop_at(array, 0, &popped);
+    expect_should_be(0, popped.value);
+    u32 after_front[] = { 1, 2, 3, 4, 5 };
+    expect_to_be_true(array_matches(array, after_front, 5));
+
+    darray_pop_at(array, 2, &popped);
+    expect_should_be(3, popped.value);
+    expect_should_be(element(3).check, popped.check);
+    u32 after_middle[] = { 1, 2, 4, 5 };
+    expect_to_be_true(array_matches(array, after_middle, 4));
+
+    darray_pop_at(array, 3, &popped);
+    expect_should_be(5, popped.value);
+    u32 after_end[] = { 1, 2, 4 };
+    expect_to_be_true(array_matches(array, after_end, 3));
+
+    darray_destroy(array);
+    return TRUE;
+}
+
+static b8 pop_at_without_destination()
+{
+    // The way event_unregister removes a listener.
+    test_element* array = array_of(4);
+    darray_pop_at(array, 1, 0);
+    u32 expected[] = { 0, 2, 3 };
+    expect_to_be_true(array_matches(array, expected, 3));
+
+    darray_destroy(array);
+    return TRUE;
+}
+
+static b8 pop_at_out_of_bounds_leaves_the_array()
+{
+    test_element* array = array_of(3);
+    test_element popped = element(99);
+    darray_pop_at(array, 3, &popped);
+    expect_should_be(99, popped.value);
+    u32 expected[] = { 0, 1, 2 };
+    expect_to_be_true(array_matches(array, expected, 3));
+
+    darray_destroy(array);
+    return TRUE;
+}
+
+static b8 insert_at_front_middle_and_end()
+{
+    // Created with a capacity of 1, so most of these inserts also grow the array.
+    test_element* array = array_of(2);
+
+    darray_insert_at(array, 0, element(10));
+    u32 after_front[] = { 10, 0, 1 };
+    expect_to_be_true(array_matches(array, after_front, 3));
+
+    darray_insert_at(array, 2, element(11));
+    u32 after_middle[] = { 10, 0, 11, 1 };
+    expect_to_be_true(array_matches(array, after_middle, 4));
+
+    // Inserting at the length appends.
+    darray_insert_at(array, 4, element(12));
+    u32 after_end[] = { 10, 0, 11, 1, 12 };
+    expect_to_be_true(array_matches(array, after_end, 5));
+
+    // Past the length is refused.
+    darray_insert_at(array, 7, element(13));
+    expect_to_be_true(array_matches(array, after_end, 5));
+
+    darray_destroy(array);
+    return TRUE;
+}
+
+static b8 overlapping_shifts_keep_every_element()
+{
+    // Shifting by one element over a long run is the case memcpy got wrong.
+    const u32 count = 1000;
+    test_element* array = array_of(count);
+
+    darray_insert_at(array, 1, element(5000));
+    expect_should_be(count + 1, darray_length(array));
+    expect_should_be(0, array[0].value);
+    expect_should_be(5000, array[1].value);
+    for (u32 i = 1; i < count; ++i) {
+        expect_should_be(i, array[i + 1].value);
+        expect_should_be(element(i).check, array[i + 1].check);
+    }
+
+    darray_pop_at(array, 1, 0);
+    for (u32 i = 0; i < count; ++i) {
+        expect_should_be(i, array[i].value);
+        expect_should_be(element(i).check, array[i].check);
+    }
+
+    // A range shorter than what follows it, so the source and destination overlap.
+    darray_erase_range(array, 10, 3);
+    expect_should_be(count - 3, darray_length(array));
+    for (u32 i = 0; i < count - 3; ++i)
+        expect_should_be(i < 10 ? i : i + 3, array[i].value);
+
+    darray_destroy(array);
+    return TRUE;
+}
+
+static b8 swap_remove_last_and_middle()
+{
+    test_element* array = array_of(5);
+    test_element removed = { 0 };
+
+    // Removing the last element has nothing to move into its place.
+    darray_swap_remove(array, 4, &removed);
+    expect_should_be(4, removed.value);
+    u32 after_last[] = { 0, 1, 2, 3 };
+    expect_to_be_true(array_matches(array, after_last, 4));
+
+    darray_swap_remove(array, 1, &removed);
+    expect_should_be(1, removed.value);
+    u32 after_middle[] = { 0, 3, 2 };
+    expect_to_be_true(array_matches(array, after_middle, 3));
+
+    // Down to a single element, which is also the last.
+    darray_swap_remove(array, 0, 0);
+    darray_swap_remove(array, 0, 0);
+    darray_swap_remove(array, 0, 0);
+    expect_should_be(0, darray_length(array));
+
+    // Nothing left to remove.
+    darray_swap_remove(array, 0, 0);
+    expect_should_be(0, darray_length(array));
+
+    darray_destroy(array);
+    return TRUE;
+}
+
+static b8 erase_range_bounds()
+{
+    test_element* array = array_of(6);
+
+    // An empty range at the very end is allowed and does nothing.
+    darray_erase_range(array, 6, 0);
+    expect_should_be(6, darray_length(array));
+
+    // Ranges reaching past the end, or starting past it, are refused.
+    darray_erase_range(array, 4, 3);
+    darray_erase_range(array, 7, 0);
+    u32 unchanged[] = { 0, 1, 2, 3, 4, 5 };
+    expect_to_be_true(array_matches(array, unchanged, 6));
+
+    // A range ending exactly at the end.
+    darray_erase_range(array, 4, 2);
+    u32 after_tail[] = { 0, 1, 2, 3 };
+    expect_to_be_true(array_matches(array, after_tail, 4));
+
+    darray_erase_range(array, 0, 1);
+    u32 after_head[] = { 1, 2, 3 };
+    expect_to_be_true(array_matches(array, after_head, 3));
+
+    darray_erase_range(array, 0, 3);
+    expect_should_be(0, darray_length(array));
+
+    darray_destroy(array);
+    return TRUE;
+}
+
+// Pointer element types, where const on the array must not end up on the pointee.
+DARRAY_DEFINE_NAMED(char*, str)
+DARRAY_DEFINE_NAMED(const char*, cstr)
+DARRAY_DEFINE(test_element)
+
+static b8 typed_functions_match_the_generic_macros()
+{
+    test_element* array = darray_test_element_create(0);
+    for (u32 i = 0; i < 4; ++i)
+        array = darray_test_element_push(array, element(i));
+    array = darray_test_element_insert(array, 0, element(10));
+    array = darray_test_element_insert(array, 5, element(11));
+    u32 expected[] = { 10, 0, 1, 2, 3, 11 };
+    expect_to_be_true(array_matches(array, expected, 6));
+
+    expect_should_be(11, darray_test_element_pop(array).value);
+    expect_should_be(10, darray_test_element_swap_remove(array, 0).value);
+    u32 after_removal[] = { 3, 0, 1, 2 };
+    expect_to_be_true(array_matches(array, after_removal, 4));
+
+    // Out of bounds is refused, the same as darray_insert_at.
+    array = darray_test_element_insert(array, 9, element(12));
+    expect_to_be_true(array_matches(array, after_removal, 4));
+    darray_destroy(array);
+
+    char first[] = "first";
+    char** strings = darray_str_create(1);
+    strings = darray_str_push(strings, first);
+    expect_to_be_true(darray_str_get(strings, 0) == first);
+    darray_str_get(strings, 0)[0] = 'F';
+    expect_should_be('F', first[0]);
+    darray_destroy(strings);
+
+    const char** names = darray_cstr_create(1);
+    names = darray_cstr_push(names, "a");
+    names = darray_cstr_insert(names, 0, "b");
+    expect_should_be('b', darray_cstr_get(names, 0)[0]);
+    expect_should_be('a', darray_cstr_get(names, 1)[0]);
+    darray_destroy(names);
+
+    return TRUE;
+}
+
+void darray_register_tests()
+{
+    test_manager_register_test(pop_copies_a_whole_element, "darray pop copies a whole element");
+    test_manager_register_test(pop_at_front_middle_and_end, "darray pop_at at the front, middle and end");
+    test_manager_register_test(pop_at_without_destination, "darray pop_at without a destination");
+    test_manager_register_test(pop_at_out_of_bounds_leaves_the_array, "darray pop_at out of bounds leaves the array");
+    test_manager_register_test(insert_at_front_middle_and_end, "darray insert_at at the front, middle and end");
+    test_manager_register_test(overlapping_shifts_keep_every_element, "darray overlapping shifts keep every element");
+    test_manager_register_test(swap_remove_last_and_middle, "darray swap_remove of the last and a middle element");
+    test_manager_register_test(erase_range_bounds, "darray erase_range bounds");
+    test_manager_register_test(typed_functions_match_the_generic_macros, "darray typed functions, including pointer types");
+}
@@ -0,0 +1,201 @@
+#include "ring_queue_tests.h"
+
+#include "../expect.h"
+#include "../test_manager.h"
+#include "../test_thread.h"
+
+#include <containers/ring_queue.h>
+#include <core/kmemory.h>
+
+// Small enough that producers keep finding the queue full, and positions wrap many times.
+#define QUEUE_CAPACITY 64
+#define BATCH_SIZE 16
+
+#define SPSC_COUNT 200000
+
+#define MPMC_PAIRS 4
+#define MPMC_COUNT_PER_PRODUCER 50000
+
+// Values carry their producer in the upper half and a sequence number in the lower half.
+#define VALUE_MAKE(producer, sequence) (((u64)(producer) << 32) | (u64)(sequence))
+#define VALUE_PRODUCER(value) ((u32)((value) >> 32))
+#define VALUE_SEQUENCE(value) ((u32)(value))
+
+typedef struct queue_test {
+    ring_queue queue;
+    u32 producer_count;
+    u32 count_per_producer;
+    b8 batched;
+
+    // The number of times each value was dequeued, indexed by producer, then sequence.
+    u8* seen;
+    // Values dequeued so far, by every consumer together.
+    u64 consumed;
+    // Set by any thread that sees a value it should not have.
+    b8 failed;
+} queue_test;
+
+typedef struct queue_test_thread {
+    queue_test* test;
+    // Producers and consumers are numbered separately.
+    u32 index;
+    b8 is_producer;
+} queue_test_thread;
+
+static void produce(queue_test_thread* thread)
+{
+    queue_test* test = thread->test;
+    u64 values[BATCH_SIZE];
+    u32 sequence = 0;
+
+    while (sequence < test->count_per_producer) {
+        u32 count = test->batched ? BATCH_SIZE : 1;
+        if (count > test->count_per_producer - sequence)
+            count = test->count_per_producer - sequence;
+        for (u32 i = 0; i < count; ++i)
+            values[i] = VALUE_MAKE(thread->index, sequence + i);
+
+        u64 enqueued = ring_queue_enqueue_n(&test->queue, values, count);
+        // A partial batch was still enqueued from the front, so carry on after it.
+        sequence += (u32)enqueued;
+        if (enqueued < count)
+            test_thread_yield();
+    }
+}
+
+static void consume(queue_test_thread* thread)
+{
+    queue_test* test = thread->test;
+    u64 total = (u64)test->producer_count * test->count_per_producer;
+    u64 values[BATCH_SIZE];
+    // The next sequence number expected from each producer. A single consumer claims positions in
+    // order, so even with several consumers, what it sees of one producer must never go backwards.
+    u32 next[MPMC_PAIRS] = { 0 };
+
+    while (__atomic_load_n(&test->consumed, __ATOMIC_ACQUIRE) < total) {
+        u64 count = ring_queue_dequeue_n(&test->queue, values, test->batched ? BATCH_SIZE : 1);
+        if (!count) {
+            test_thread_yield();
+            continue;
+        }
+
+        for (u64 i = 0; i < count; ++i) {
+            u32 producer = VALUE_PRODUCER(values[i]);
+            u32 sequence = VALUE_SEQUENCE(values[i]);
+            if (producer >= test->producer_count || sequence >= test->count_per_producer || sequence < next[producer]) {
+                __atomic_store_n(&test->failed, TRUE, __ATOMIC_RELEASE);
+                continue;
+            }
+            next[producer] = sequence + 1;
+            __atomic_add_fetch(&test->seen[producer * test->count_per_producer + sequence], 1, __ATOMIC_RELAXED);
+        }
+        __atomic_add_fetch(&test->consumed, count, __ATOMIC_RELEASE);
+    }
+}
+
+static void queue_test_thread_run(void* arg)
+{
+    queue_test_thread* thread = arg;
+    if (thread->is_producer)
+        produce(thread);
+    else
+        consume(thread);
+}
+
+/**
+ * Runs pair_count producers and as many consumers on one queue, then checks that every value
+ * produced was consumed exactly once, and that each producer's values arrived in order.
+ */
+static b8 run_queue_test(ring_queue_mode mode, u32 pair_count, u32 count_per_producer, b8 batched)
+{
+    queue_test test = { 0 };
+    test.producer_count = pair_count;
+    test.count_per_producer = count_per_producer;
+    test.batched = batched;
+    expect_to_be_true(ring_queue_create(sizeof(u64), QUEUE_CAPACITY, mode, &test.queue));
+
+    u64 seen_size = (u64)pair_count * count_per_producer;
+    test.seen = kallocate(seen_size, MEMORY_TAG_ARRAY);
+
+    queue_test_thread threads[MPMC_PAIRS * 2];
+    for (u32 i = 0; i < pair_count * 2; ++i) {
+        threads[i].test = &test;
+        threads[i].index = i % pair_count;
+        threads[i].is_producer = i < pair_count;
+    }
+    b8 ran = test_run_threads(pair_count * 2, queue_test_thread_run, threads, sizeof(queue_test_thread));
+
+    u64 missing = 0;
+    u64 duplicated = 0;
+    for (u64 i = 0; i < seen_size; ++i) {
+        if (test.seen[i] == 0)
+            missing++;
+        else if (test.seen[i] > 1)
+            duplicated++;
+    }
+    u64 left = ring_queue_length(&test.queue);
+
+    kfree(test.seen, seen_size, MEMORY_TAG_ARRAY);
+    ring_queue_destroy(&test.queue);
+
+    expect_to_be_true(ran);
+    expect_to_be_false(test.failed);
+    expect_should_be(seen_size, test.consumed);
+    expect_should_be(0, missing);
+    expect_should_be(0, duplicated);
+    expect_should_be(0, left);
+    return TRUE;
+}
+
+static b8 spsc_delivers_every_value_once_in_order()
+{
+    return run_queue_test(RING_QUEUE_MODE_SPSC, 1, SPSC_COUNT, FALSE);
+}
+
+static b8 spsc_batches_deliver_every_value_once_in_order()
+{
+    return run_queue_test(RING_QUEUE_MODE_SPSC, 1, SPSC_COUNT, TRUE);
+}
+
+static b8 mpmc_delivers_every_value_once()
+{
+    return run_queue_test(RING_QUEUE_MODE_MPMC, MPMC_PAIRS, MPMC_COUNT_PER_PRODUCER, FALSE);
+}
+
+static b8 mpmc_batches_deliver_every_value_once()
+{
+    return run_queue_test(RING_QUEUE_MODE_MPMC, MPMC_PAIRS, MPMC_COUNT_PER_PRODUCER, TRUE);
+}
+
+static b8 full_and_empty_are_refused()
+{
+    ring_queue queue;
+    expect_to_be_true(ring_queue_create(sizeof(u64), 3, RING_QUEUE_MODE_MPMC, &queue));
+    // Rounded up to a power of two.
+    expect_should_be(4, queue.capacity);
+
+    u64 value = 0;
+    expect_to_be_false(ring_queue_dequeue(&queue, &value));
+    for (u64 i = 0; i < 4; ++i)
+        expect_to_be_true(ring_queue_enqueue(&queue, &i));
+    expect_to_be_false(ring_queue_enqueue(&queue, &value));
+    expect_should_be(4, ring_queue_length(&queue));
+
+    for (u64 i = 0; i < 4; ++i) {
+        expect_to_be_true(ring_queue_dequeue(&queue, &value));
+        expect_should_be(i, value);
+    }
+    expect_to_be_false(ring_queue_dequeue(&queue, &value));
+
+    ring_queue_destroy(&queue);
+    return TRUE;
+}
+
+void ring_queue_register_tests()
+{
+    test_manager_register_test(full_and_empty_are_refused, "ring_queue refuses to overfill or underflow");
+    test_manager_register_test(spsc_delivers_every_value_once_in_order, "ring_queue SPSC delivers every value once, in order");
+    test_manager_register_test(spsc_batches_deliver_every_value_once_in_order, "ring_queue SPSC batches deliver every value once, in order");
+    test_manager_register_test(mpmc_delivers_every_value_once, "ring_queue MPMC delivers every value once, with 4 producers and 4 consumers");
+    test_manager_register_test(mpmc_batches_deliver_every_value_once, "ring_queue MPMC batches deliver every value once, with 4 producers and 4 consumers");
+}
@@ -0,0 +1,141 @@
+#include "event_tests.h"
+
+#include "../expect.h"
+#include "../test_manager.h"
+
+#include <core/event.h>
+
+// An application code, which lives in the hash table rather than the system entries.
+#define TEST_EVENT_CODE 1000
+
+#define MAX_CALLS 16
+
+// Listeners are numbered by the u32 their instance points at, and record the order they are called in.
+static u32 calls[MAX_CALLS];
+static u32 call_count;
+
+static u32 listener_ids[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+
+// Which listener to unregister when a listener is called, by listener. ~0u for none.
+static u32 unregisters[8];
+
+static b8 on_event(u16 code, void* sender, void* listener_inst, event_context data)
+{
+    u32 id = *(u32*)listener_inst;
+    if (call_count < MAX_CALLS)
+        calls[call_count] = id;
+    call_count++;
+
+    if (unregisters[id] != ~0u)
+        event_unregister(code, &listener_ids[unregisters[id]], on_event);
+    return FALSE;
+}
+
+// Registers count listeners, numbered from 0, for the code.
+static b8 setup(u16 code, u32 count)
+{
+    call_count = 0;
+    for (u32 i = 0; i < 8; ++i)
+        unregisters[i] = ~0u;
+
+    // A failed test returns early, so start from a clean system regardless.
+    event_shutdown();
+    if (!event_initialize())
+        return FALSE;
+    for (u32 i = 0; i < count; ++i) {
+        if (!event_register(code, &listener_ids[i], on_event))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static b8 calls_match(const u32* expected, u32 count)
+{
+    if (call_count != count)
+        return FALSE;
+    for (u32 i = 0; i < count; ++i) {
+        if (calls[i] != expected[i])
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static b8 fire(u16 code)
+{
+    event_context context = { 0 };
+    return event_fire(code, 0, context);
+}
+
+static b8 self_unregister_does_not_skip_the_next_listener()
+{
+    // Once in the inline listeners, and once in the overflow array.
+    for (u32 first = 0; first < 5; first += 4) {
+        expect_to_be_true(setup(EVENT_CODE_APPLICATION_QUIT, 6));
+        unregisters[first] = first;
+
+        fire(EVENT_CODE_APPLICATION_QUIT);
+        u32 expected[] = { 0, 1, 2, 3, 4, 5 };
+        expect_to_be_true(calls_match(expected, 6));
+
+        // It stays unregistered.
+        call_count = 0;
+        fire(EVENT_CODE_APPLICATION_QUIT);
+        expect_should_be(5, call_count);
+        event_shutdown();
+    }
+    return TRUE;
+}
+
+static b8 unregistering_an_earlier_listener_does_not_skip_the_next()
+{
+    expect_to_be_true(setup(EVENT_CODE_APPLICATION_QUIT, 5));
+    unregisters[2] = 0;
+
+    fire(EVENT_CODE_APPLICATION_QUIT);
+    u32 expected[] = { 0, 1, 2, 3, 4 };
+    expect_to_be_true(calls_match(expected, 5));
+
+    event_shutdown();
+    return TRUE;
+}
+
+static b8 unregistering_a_later_listener_skips_it()
+{
+    expect_to_be_true(setup(EVENT_CODE_APPLICATION_QUIT, 4));
+    unregisters[1] = 2;
+
+    fire(EVENT_CODE_APPLICATION_QUIT);
+    u32 expected[] = { 0, 1, 3 };
+    expect_to_be_true(calls_match(expected, 3));
+
+    event_shutdown();
+    return TRUE;
+}
+
+static b8 every_listener_can_unregister_itself()
+{
+    // The last one to go removes the application code's entry altogether.
+    expect_to_be_true(setup(TEST_EVENT_CODE, 4));
+    for (u32 i = 0; i < 4; ++i)
+        unregisters[i] = i;
+
+    fire(TEST_EVENT_CODE);
+    u32 expected[] = { 0, 1, 2, 3 };
+    expect_to_be_true(calls_match(expected, 4));
+
+    call_count = 0;
+    fire(TEST_EVENT_CODE);
+    expect_should_be(0, call_count);
+    expect_to_be_false(event_unregister(TEST_EVENT_CODE, &listener_ids[0], on_event));
+
+    event_shutdown();
+    return TRUE;
+}
+
+void event_register_tests()
+{
+    test_manager_register_test(self_unregister_does_not_skip_the_next_listener, "event self unregistering does not skip the next listener");
+    test_manager_register_test(unregistering_an_earlier_listener_does_not_skip_the_next, "event unregistering an earlier listener does not skip the next");
+    test_manager_register_test(unregistering_a_later_listener_skips_it, "event unregistering a later listener skips it");
+    test_manager_register_test(every_listener_can_unregister_itself, "event every listener can unregister itself");
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <core/logger.h>
+
+// Each of these fails the calling test, which must return a b8, if the expectation does not hold.
+
+#define expect_should_be(expected, actual)                                                                                    \
+    if ((i64)(actual) != (i64)(expected)) {                                                                                   \
+        KERROR("--> Expected %lld, but got: %lld. File: %s:%d.", (i64)(expected), (i64)(actual), __FILE__, __LINE__);         \
+        return FALSE;                                                                                                         \
+    }
+
+#define expect_should_not_be(expected, actual)                                                                                \
+    if ((i64)(actual) == (i64)(expected)) {                                                                                   \
+        KERROR("--> Expected %lld != %lld, but they are equal. File: %s:%d.", (i64)(expected), (i64)(actual), __FILE__, __LINE__); \
+        return FALSE;                                                                                                         \
+    }
+
+#define expect_to_be_true(actual)                                                      \
+    if (!(actual)) {                                                                   \
+        KERROR("--> Expected %s to be true. File: %s:%d.", #actual, __FILE__, __LINE__); \
+        return FALSE;                                                                  \
+    }
+
+#define expect_to_be_false(actual)                                                      \
+    if (actual) {                                                                       \
+        KERROR("--> Expected %s to be false. File: %s:%d.", #actual, __FILE__, __LINE__); \
+        return FALSE;                                                                   \
+    }
@@ -0,0 +1,35 @@
+#include "test_manager.h"
+
+#include <core/kmemory.h>
+#include <core/logger.h>
+
+#include "containers/darray_tests.h"
+#include "containers/ring_queue_tests.h"
+#include "core/event_tests.h"
+#include "renderer/vulkan/vulkan_memory_allocator_tests.h"
+
+int main(void)
+{
+    memory_system_configuration memory_config = {
+        .total_alloc_size = MEBIBYTES(64),
+    };
+
+    if (!initialize_memory(memory_config)) {
+        KFATAL("Failed to initialize the memory system!");
+        return -1;
+    }
+
+    // Always initialize the test manager first.
+    test_manager_init();
+
+    darray_register_tests();
+    ring_queue_register_tests();
+    event_register_tests();
+    vulkan_memory_allocator_register_tests();
+
+    KDEBUG("Starting tests...");
+    u32 failed = test_manager_run_tests();
+
+    shutdown_memory();
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,332 @@
+#include "vulkan_memory_allocator_tests.h"
+
+#include "../../expect.h"
+#include "../../test_manager.h"
+
+#include <core/kmemory.h>
+#include <renderer/vulkan/vulkan_memory_allocator.h>
+
+/**
+ * The allocator runs against a fake driver, so none of this needs a GPU. Device memory handles are
+ * just counters, and mapping hands back a fixed base that is never written through.
+ */
+typedef struct fake_driver {
+    u64 next_handle;
+    u32 live_count;
+    u32 mapped_count;
+} fake_driver;
+
+static fake_driver driver;
+static vulkan_context context;
+static u8 fake_mapping[1];
+
+#define DEVICE_LOCAL_TYPE 0
+#define UPLOAD_TYPE 1
+#define READBACK_TYPE 2
+
+// Device local blocks are the full 64MiB, host visible ones are capped to an eighth of their 256MiB heap.
+#define DEVICE_LOCAL_BLOCK_SIZE MEBIBYTES(64)
+#define HOST_BLOCK_SIZE MEBIBYTES(32)
+#define NON_COHERENT_ATOM_SIZE 64
+
+static VkResult VKAPI_PTR fake_allocate(VkDevice device, const VkMemoryAllocateInfo* info, const VkAllocationCallbacks* callbacks, VkDeviceMemory* out_memory)
+{
+    *out_memory = (VkDeviceMemory)(++driver.next_handle);
+    driver.live_count++;
+    return VK_SUCCESS;
+}
+
+static void VKAPI_PTR fake_free(VkDevice device, VkDeviceMemory memory, const VkAllocationCallbacks* callbacks)
+{
+    driver.live_count--;
+}
+
+static VkResult VKAPI_PTR fake_map(VkDevice device, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize size, VkMemoryMapFlags flags, void** out_data)
+{
+    *out_data = fake_mapping;
+    driver.mapped_count++;
+    return VK_SUCCESS;
+}
+
+static void VKAPI_PTR fake_unmap(VkDevice device, VkDeviceMemory memory)
+{
+    driver.mapped_count--;
+}
+
+// A device with a device local heap, and a smaller host visible heap with coherent and cached types.
+static b8 fake_context_create(VkDeviceSize buffer_image_granularity)
+{
+    kzero_memory(&driver, sizeof(fake_driver));
+    kzero_memory(&context, sizeof(vulkan_context));
+
+    VkPhysicalDeviceLimits* limits = &context.device.properties.limits;
+    limits->maxMemoryAllocationCount = 4096;
+    limits->bufferImageGranularity = buffer_image_granularity;
+    limits->nonCoherentAtomSize = NON_COHERENT_ATOM_SIZE;
+
+    VkPhysicalDeviceMemoryProperties* memory = &context.device.memory;
+    memory->memoryHeapCount = 2;
+    memory->memoryHeaps[0].size = GIBIBYTES(1);
+    memory->memoryHeaps[1].size = MEBIBYTES(256);
+    memory->memoryTypeCount = 3;
+    memory->memoryTypes[DEVICE_LOCAL_TYPE].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    memory->memoryTypes[DEVICE_LOCAL_TYPE].heapIndex = 0;
+    memory->memoryTypes[UPLOAD_TYPE].propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    memory->memoryTypes[UPLOAD_TYPE].heapIndex = 1;
+    memory->memoryTypes[READBACK_TYPE].propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    memory->memoryTypes[READBACK_TYPE].heapIndex = 1;
+
+    static const u32 usage_types[VULKAN_MEMORY_USAGE_MAX] = { DEVICE_LOCAL_TYPE, UPLOAD_TYPE, READBACK_TYPE, DEVICE_LOCAL_TYPE };
+    for (u32 usage = 0; usage < VULKAN_MEMORY_USAGE_MAX; ++usage) {
+        context.device.memory_usage_preferred_masks[usage] = 1 << usage_types[usage];
+        context.device.memory_usage_acceptable_masks[usage] = 1 << usage_types[usage];
+    }
+
+    vulkan_memory_functions functions = { fake_allocate, fake_free, fake_map, fake_unmap };
+    return vulkan_memory_allocator_create(&context, &functions, &context.memory_allocator);
+}
+
+// Destroys the allocator, which must have handed every block back to the fake driver.
+static b8 fake_context_destroy()
+{
+    vulkan_memory_allocator_destroy(&context, &context.memory_allocator);
+    expect_should_be(0, driver.live_count);
+    expect_should_be(0, driver.mapped_count);
+    return TRUE;
+}
+
+static b8 allocate(VkDeviceSize size, VkDeviceSize alignment, vulkan_memory_usage usage, vulkan_memory_kind kind, vulkan_allocation* out_allocation)
+{
+    VkMemoryRequirements requirements = { size, alignment, ~0u };
+    return vulkan_memory_allocate(&context, &requirements, usage, kind, out_allocation);
+}
+
+static vulkan_memory_stats stats_of(u32 memory_type_index)
+{
+    vulkan_memory_stats stats;
+    vulkan_memory_allocator_get_stats(&context.memory_allocator, memory_type_index, &stats);
+    return stats;
+}
+
+static b8 alignment_splits_the_head_and_tail()
+{
+    expect_to_be_true(fake_context_create(1));
+
+    vulkan_allocation first, aligned, small;
+    expect_to_be_true(allocate(100, 1, VULKAN_MEMORY_USAGE_DEVICE_LOCAL, VULKAN_MEMORY_KIND_LINEAR, &first));
+    expect_should_be(0, first.offset);
+    expect_should_be(DEVICE_LOCAL_TYPE, first.memory_type_index);
+
+    // Aligning past the end of the first leaves a gap before it, and the rest of the block after it.
+    expect_to_be_true(allocate(100, 256, VULKAN_MEMORY_USAGE_DEVICE_LOCAL, VULKAN_MEMORY_KIND_LINEAR, &aligned));
+    expect_should_be(256, aligned.offset);
+    expect_to_be_true(aligned.memory == first.memory);
+
+    vulkan_memory_block* block = first.block;
+    expect_should_be(2, block->free_range_count);
+    expect_should_be(100, block->free_ranges[0].offset);
+    expect_should_be(156, block->free_ranges[0].size);
+    expect_should_be(356, block->free_ranges[1].offset);
+    expect_should_be(DEVICE_LOCAL_BLOCK_SIZE - 356, block->free_ranges[1].size);
+
+    // The gap is the best fit for something small, which takes its head and leaves the tail.
+    expect_to_be_true(allocate(50, 1, VULKAN_MEMORY_USAGE_DEVICE_LOCAL, VULKAN_MEMORY_KIND_LINEAR, &small));
+    expect_should_be(100, small.offset);
+    expect_should_be(150, block->free_ranges[0].offset);
+    expect_should_be(106, block->free_ranges[0].size);
+
+    vulkan_memory_stats stats = stats_of(DEVICE_LOCAL_TYPE);
+    expect_should_be(3, stats.allocation_count);
+    expect_should_be(250, stats.used);
+    expect_should_be(1, stats.block_count);
+
+    vulkan_memory_free(&context, &small);
+    vulkan_memory_free(&context, &aligned);
+    vulkan_memory_free(&context, &first);
+    expect_should_be(1, block->free_range_count);
+    expect_should_be(0, block->free_ranges[0].offset);
+    expect_should_be(DEVICE_LOCAL_BLOCK_SIZE, block->free_ranges[0].size);
+
+    return fake_context_destroy();
+}
+
+static b8 freed_ranges_merge_with_their_neighbours()
+{
+    expect_to_be_true(fake_context_create(1));
+
+    vulkan_allocation allocations[4];
+    for (u32 i = 0; i < 4; ++i) {
+        expect_to_be_true(allocate(1000, 1, VULKAN_MEMORY_USAGE_DEVICE_LOCAL, VULKAN_MEMORY_KIND_LINEAR, &allocations[i]));
+        expect_should_be(i * 1000, allocations[i].offset);
+    }
+    vulkan_memory_block* block = allocations[0].block;
+
+    // No free neighbour at all.
+    vulkan_memory_free(&context, &allocations[1]);
+    expect_should_be(2, block->free_range_count);
+
+    // A free neighbour in front.
+    vulkan_memory_free(&context, &allocations[2]);
+    expect_should_be(2, block->free_range_count);
+    expect_should_be(1000, block->free_ranges[0].offset);
+    expect_should_be(2000, block->free_ranges[0].size);
+
+    // A free neighbour behind.
+    vulkan_memory_free(&context, &allocations[0]);
+    expect_should_be(2, block->free_range_count);
+    expect_should_be(0, block->free_ranges[0].offset);
+    expect_should_be(3000, block->free_ranges[0].size);
+
+    // Free neighbours on both sides, which leaves one range covering the block.
+    vulkan_memory_free(&context, &allocations[3]);
+    expect_should_be(1, block->free_range_count);
+    expect_should_be(DEVICE_LOCAL_BLOCK_SIZE, block->free_ranges[0].size);
+    expect_should_be(0, block->used);
+
+    return fake_context_destroy();
+}
+
+static b8 large_resources_get_dedicated_blocks()
+{
+    expect_to_be_true(fake_context_create(1));
+
+    vulkan_allocation shared, dedicated;
+    expect_to_be_true(allocate(1000, 1, VULKAN_MEMORY_USAGE_DEVICE_LOCAL, VULKAN_MEMORY_KIND_LINEAR, &shared));
+    expect_to_be_true(allocate(DEVICE_LOCAL_BLOCK_SIZE / VULKAN_MEMORY_DEDICATED_DIVISOR, 1, VULKAN_MEMORY_USAGE_DEVICE_LOCAL, VULKAN_MEMORY_KIND_LINEAR, &dedicated));
+
+    expect_to_be_true(dedicated.block->dedicated);
+    expect_to_be_false(dedicated.memory == shared.memory);
+    expect_should_be(0, dedicated.offset);
+    expect_should_be(DEVICE_LOCAL_BLOCK_SIZE / VULKAN_MEMORY_DEDICATED_DIVISOR, dedicated.block->size);
+
+    vulkan_memory_stats stats = stats_of(DEVICE_LOCAL_TYPE);
+    expect_should_be(2, stats.block_count);
+    expect_should_be(1, stats.dedicated_block_count);
+
+    // A dedicated block goes back to the driver as soon as its resource is freed.
+    vulkan_memory_free(&context, &dedicated);
+    stats = stats_of(DEVICE_LOCAL_TYPE);
+    expect_should_be(1, stats.block_count);
+    expect_should_be(0, stats.dedicated_block_count);
+    expect_should_be(1, driver.live_count);
+
+    vulkan_memory_free(&context, &shared);
+    return fake_context_destroy();
+}
+
+static b8 linear_and_optimal_resources_use_separate_blocks()
+{
+    vulkan_allocation linear, optimal;
+
+    expect_to_be_true(fake_context_create(1024));
+    expect_to_be_true(allocate(1000, 1, VULKAN_MEMORY_USAGE_DEVICE_LOCAL, VULKAN_MEMORY_KIND_LINEAR, &linear));
+    expect_to_be_true(allocate(1000, 1, VULKAN_MEMORY_USAGE_DEVICE_LOCAL, VULKAN_MEMORY_KIND_OPTIMAL, &optimal));
+    expect_to_be_false(linear.memory == optimal.memory);
+    expect_should_be(VULKAN_MEMORY_KIND_OPTIMAL, optimal.kind);
+    expect_should_be(0, optimal.offset);
+    vulkan_memory_free(&context, &optimal);
+    vulkan_memory_free(&context, &linear);
+    if (!fake_context_destroy())
+        return FALSE;
+
+    // Without a granularity to keep them apart, they share a block.
+    expect_to_be_true(fake_context_create(1));
+    expect_to_be_true(allocate(1000, 1, VULKAN_MEMORY_USAGE_DEVICE_LOCAL, VULKAN_MEMORY_KIND_LINEAR, &linear));
+    expect_to_be_true(allocate(1000, 1, VULKAN_MEMORY_USAGE_DEVICE_LOCAL, VULKAN_MEMORY_KIND_OPTIMAL, &optimal));
+    expect_to_be_true(linear.memory == optimal.memory);
+    expect_should_be(VULKAN_MEMORY_KIND_LINEAR, optimal.kind);
+    expect_should_be(1000, optimal.offset);
+    vulkan_memory_free(&context, &optimal);
+    vulkan_memory_free(&context, &linear);
+    return fake_context_destroy();
+}
+
+static b8 empty_blocks_are_released_but_one()
+{
+    expect_to_be_true(fake_context_create(1));
+
+    // Just under the dedicated size, so two fit in a block and the third needs another.
+    const VkDeviceSize size = DEVICE_LOCAL_BLOCK_SIZE / VULKAN_MEMORY_DEDICATED_DIVISOR - 1024;
+    vulkan_allocation allocations[3];
+    for (u32 i = 0; i < 3; ++i)
+        expect_to_be_true(allocate(size, 1, VULKAN_MEMORY_USAGE_DEVICE_LOCAL, VULKAN_MEMORY_KIND_LINEAR, &allocations[i]));
+    expect_to_be_true(allocations[0].memory == allocations[1].memory);
+    expect_to_be_false(allocations[0].memory == allocations[2].memory);
+    expect_should_be(2, stats_of(DEVICE_LOCAL_TYPE).block_count);
+
+    // The only empty block is kept for reuse.
+    vulkan_memory_free(&context, &allocations[2]);
+    expect_should_be(2, stats_of(DEVICE_LOCAL_TYPE).block_count);
+
+    // A second empty one is not.
+    vulkan_memory_free(&context, &allocations[0]);
+    vulkan_memory_free(&context, &allocations[1]);
+    expect_should_be(1, stats_of(DEVICE_LOCAL_TYPE).block_count);
+    expect_should_be(1, driver.live_count);
+
+    expect_should_be(1, vulkan_memory_allocator_trim(&context, &context.memory_allocator));
+    expect_should_be(0, stats_of(DEVICE_LOCAL_TYPE).block_count);
+    expect_should_be(0, stats_of(DEVICE_LOCAL_TYPE).reserved);
+
+    return fake_context_destroy();
+}
+
+static b8 host_visible_memory_is_mapped_and_atom_aligned()
+{
+    expect_to_be_true(fake_context_create(1));
+
+    // Coherent memory needs no flushing, so allocations pack tightly.
+    vulkan_allocation upload[2];
+    for (u32 i = 0; i < 2; ++i)
+        expect_to_be_true(allocate(10, 1, VULKAN_MEMORY_USAGE_UPLOAD, VULKAN_MEMORY_KIND_LINEAR, &upload[i]));
+    expect_should_be(UPLOAD_TYPE, upload[1].memory_type_index);
+    expect_should_be(10, upload[1].offset);
+    expect_to_be_true(upload[1].mapped == fake_mapping + 10);
+    expect_should_be(HOST_BLOCK_SIZE, upload[1].block->size);
+
+    // Non-coherent memory is flushed in whole atoms, so no two allocations may share one.
+    vulkan_allocation readback[2];
+    for (u32 i = 0; i < 2; ++i)
+        expect_to_be_true(allocate(10, 1, VULKAN_MEMORY_USAGE_READBACK, VULKAN_MEMORY_KIND_LINEAR, &readback[i]));
+    expect_should_be(READBACK_TYPE, readback[1].memory_type_index);
+    expect_should_be(NON_COHERENT_ATOM_SIZE, readback[1].offset);
+
+    // Device local memory is never mapped.
+    vulkan_allocation device_local;
+    expect_to_be_true(allocate(10, 1, VULKAN_MEMORY_USAGE_DEVICE_LOCAL, VULKAN_MEMORY_KIND_LINEAR, &device_local));
+    expect_to_be_true(device_local.mapped == 0);
+    expect_should_be(2, driver.mapped_count);
+
+    for (u32 i = 0; i < 2; ++i) {
+        vulkan_memory_free(&context, &upload[i]);
+        vulkan_memory_free(&context, &readback[i]);
+    }
+    vulkan_memory_free(&context, &device_local);
+    return fake_context_destroy();
+}
+
+static b8 allocation_count_limit_is_respected()
+{
+    expect_to_be_true(fake_context_create(1));
+    context.device.properties.limits.maxMemoryAllocationCount = 1;
+
+    vulkan_allocation shared, dedicated;
+    expect_to_be_true(allocate(1000, 1, VULKAN_MEMORY_USAGE_DEVICE_LOCAL, VULKAN_MEMORY_KIND_LINEAR, &shared));
+    expect_to_be_false(allocate(DEVICE_LOCAL_BLOCK_SIZE, 1, VULKAN_MEMORY_USAGE_DEVICE_LOCAL, VULKAN_MEMORY_KIND_LINEAR, &dedicated));
+    expect_to_be_true(dedicated.block == 0);
+    expect_should_be(1, driver.live_count);
+
+    vulkan_memory_free(&context, &shared);
+    return fake_context_destroy();
+}
+
+void vulkan_memory_allocator_register_tests()
+{
+    test_manager_register_test(alignment_splits_the_head_and_tail, "vulkan_memory alignment splits a free range at both ends");
+    test_manager_register_test(freed_ranges_merge_with_their_neighbours, "vulkan_memory freed ranges merge with their neighbours");
+    test_manager_register_test(large_resources_get_dedicated_blocks, "vulkan_memory large resources get dedicated blocks");
+    test_manager_register_test(linear_and_optimal_resources_use_separate_blocks, "vulkan_memory linear and optimal resources use separate blocks");
+    test_manager_register_test(empty_blocks_are_released_but_one, "vulkan_memory empty blocks are released, but one");
+    test_manager_register_test(host_visible_memory_is_mapped_and_atom_aligned, "vulkan_memory host visible memory is mapped and atom aligned");
+    test_manager_register_test(allocation_count_limit_is_respected, "vulkan_memory maxMemoryAllocationCount is respected");
+}
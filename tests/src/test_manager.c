@@ -0,0 +1,45 @@
+#include "test_manager.h"
+
+#include <containers/darray.h>
+#include <core/logger.h>
+
+typedef struct test_entry {
+    PFN_test func;
+    const char* desc;
+} test_entry;
+
+static test_entry* tests;
+
+void test_manager_init()
+{
+    tests = darray_create(test_entry);
+}
+
+void test_manager_register_test(PFN_test fn, const char* desc)
+{
+    test_entry e;
+    e.func = fn;
+    e.desc = desc;
+    darray_push(tests, e);
+}
+
+u32 test_manager_run_tests()
+{
+    u32 passed = 0;
+    u32 failed = 0;
+
+    u32 count = darray_length(tests);
+    for (u32 i = 0; i < count; ++i) {
+        if (tests[i].func()) {
+            ++passed;
+        } else {
+            KERROR("[FAILED]: %s", tests[i].desc);
+            ++failed;
+        }
+        KINFO("Executed %d of %d (%d failed): %s", i + 1, count, failed, tests[i].desc);
+    }
+
+    KINFO("Results: %d passed, %d failed.", passed, failed);
+    darray_destroy(tests);
+    return failed;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <defines.h>
+
+// A test returns TRUE if it passed.
+typedef b8 (*PFN_test)();
+
+void test_manager_init();
+
+void test_manager_register_test(PFN_test fn, const char* desc);
+
+// Runs every registered test, in the order they were registered. Returns the number that failed.
+u32 test_manager_run_tests();
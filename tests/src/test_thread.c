@@ -0,0 +1,108 @@
+#include "test_thread.h"
+
+#include <core/logger.h>
+
+#if KPLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// No test needs more threads than this.
+#define TEST_MAX_THREADS 32
+
+typedef enum test_thread_start {
+    TEST_THREAD_WAIT,
+    TEST_THREAD_RUN,
+    // Not every thread could be created, so none of them runs.
+    TEST_THREAD_CANCEL
+} test_thread_start;
+
+typedef struct test_thread {
+    PFN_test_thread fn;
+    void* arg;
+    volatile i32* start;
+} test_thread;
+
+static void test_thread_body(test_thread* thread)
+{
+    i32 start;
+    while ((start = __atomic_load_n(thread->start, __ATOMIC_ACQUIRE)) == TEST_THREAD_WAIT)
+        test_thread_yield();
+    if (start == TEST_THREAD_RUN)
+        thread->fn(thread->arg);
+}
+
+#if KPLATFORM_WINDOWS
+static DWORD WINAPI test_thread_entry(LPVOID arg)
+{
+    test_thread_body(arg);
+    return 0;
+}
+#else
+static void* test_thread_entry(void* arg)
+{
+    test_thread_body(arg);
+    return 0;
+}
+#endif
+
+b8 test_run_threads(u32 thread_count, PFN_test_thread fn, void* args, u64 arg_stride)
+{
+    if (thread_count > TEST_MAX_THREADS) {
+        KERROR("test_run_threads supports at most %u threads.", TEST_MAX_THREADS);
+        return FALSE;
+    }
+
+    volatile i32 start = TEST_THREAD_WAIT;
+    test_thread threads[TEST_MAX_THREADS];
+#if KPLATFORM_WINDOWS
+    HANDLE handles[TEST_MAX_THREADS];
+#else
+    pthread_t handles[TEST_MAX_THREADS];
+#endif
+
+    u32 created = 0;
+    for (; created < thread_count; ++created) {
+        threads[created].fn = fn;
+        threads[created].arg = (u8*)args + created * arg_stride;
+        threads[created].start = &start;
+#if KPLATFORM_WINDOWS
+        handles[created] = CreateThread(0, 0, test_thread_entry, &threads[created], 0, 0);
+        if (!handles[created])
+            break;
+#else
+        if (pthread_create(&handles[created], 0, test_thread_entry, &threads[created]) != 0)
+            break;
+#endif
+    }
+
+    // A thread left out could leave the others waiting on it forever.
+    __atomic_store_n(&start, created == thread_count ? TEST_THREAD_RUN : TEST_THREAD_CANCEL, __ATOMIC_RELEASE);
+
+#if KPLATFORM_WINDOWS
+    if (created)
+        WaitForMultipleObjects(created, handles, TRUE, INFINITE);
+    for (u32 i = 0; i < created; ++i)
+        CloseHandle(handles[i]);
+#else
+    for (u32 i = 0; i < created; ++i)
+        pthread_join(handles[i], 0);
+#endif
+
+    if (created < thread_count) {
+        KERROR("test_run_threads - only %u of %u threads could be created.", created, thread_count);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void test_thread_yield()
+{
+#if KPLATFORM_WINDOWS
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
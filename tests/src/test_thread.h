@@ -0,0 +1,19 @@
+#pragma once
+
+#include <defines.h>
+
+typedef void (*PFN_test_thread)(void* arg);
+
+/**
+ * Runs thread_count threads at once and waits for all of them. Every thread is created before
+ * any of them starts, so they all contend from the first operation.
+ * @param thread_count The number of threads to run.
+ * @param fn The function every thread runs.
+ * @param args An array of thread_count arguments, one per thread.
+ * @param arg_stride The size in bytes of a single argument.
+ * @returns TRUE if every thread was created and has finished; otherwise FALSE, and none of them ran fn.
+ */
+b8 test_run_threads(u32 thread_count, PFN_test_thread fn, void* args, u64 arg_stride);
+
+// Gives up the rest of the calling thread's time slice, for threads spinning on one another.
+void test_thread_yield();